@@ -0,0 +1,48 @@
+#pragma once
+
+#include "BasicWallLayout.hpp"
+#include "BoardModel.hpp"
+#include <chrono>
+#include <fmt/format.h>
+#include <random>
+#include <vector>
+
+namespace bench {
+
+// the board sizes the game offers (see Illum::BOARD_SIZES)
+inline constexpr int BOARD_SIZES[] = {6, 8, 10, 15, 20};
+
+// Generate some levels of the given size. The generator occasionally fails
+// to produce a level; those are skipped, so fewer than count may be returned.
+inline std::vector<model::BasicBoard>
+make_boards(int size, int count, unsigned seed = 1) {
+  std::vector<model::BasicBoard> boards;
+  levels::BasicWallLayout        layout;
+  std::mt19937                   rng(seed);
+  for (int i = 0; i < count; ++i) {
+    try {
+      boards.push_back(layout.create(rng, size, size).get_underlying_board());
+    }
+    catch (std::exception const &) {
+    }
+  }
+  return boards;
+}
+
+// Run func reps times, and report the average time per call. func should
+// return something that depends on its work so it is not optimized away.
+template <typename FuncT>
+void
+time_it(char const * name, int reps, FuncT && func) {
+  using Clock    = std::chrono::steady_clock;
+  long long sink = 0;
+  auto      t0   = Clock::now();
+  for (int i = 0; i < reps; ++i) {
+    sink += func();
+  }
+  auto       t1 = Clock::now();
+  auto const ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+  fmt::print("  {:<40} {:>12.1f} ns/rep  (sink={})\n", name, ns / reps, sink);
+}
+
+} // namespace bench
@@ -0,0 +1,135 @@
+#include "BasicBoard.hpp"
+#include "bench.hpp"
+#include <algorithm>
+#include <span>
+
+// Compares the BasicBoard visitors, which rely on the border around the board
+// to end their scans, against the same scans written with a bounds check on
+// every step (which is how the visitors used to work.)
+
+namespace {
+
+using model::BasicBoard;
+using model::CellState;
+using model::Coord;
+
+int
+adjacent_visitor(BasicBoard const & board) {
+  int count = 0;
+  board.visit_board([&](Coord coord, CellState) {
+    board.visit_adjacent(coord, [&](Coord, CellState cell) {
+      count += model::is_wall(cell);
+    });
+  });
+  return count;
+}
+
+int
+adjacent_checked(BasicBoard const & board) {
+  int count = 0;
+  board.visit_board([&](Coord coord, CellState) {
+    auto [row, col] = coord;
+    for (Coord adj : {Coord{row - 1, col},
+                      Coord{row, col - 1},
+                      Coord{row + 1, col},
+                      Coord{row, col + 1}}) {
+      if (auto cell = board.get_opt_cell(adj)) {
+        count += model::is_wall(*cell);
+      }
+    }
+  });
+  return count;
+}
+
+int
+outward_visitor(BasicBoard const & board) {
+  int count = 0;
+  board.visit_board([&](Coord coord, CellState) {
+    board.visit_rows_cols_outward(coord, [&](Coord, CellState cell) {
+      count += model::is_empty(cell);
+    });
+  });
+  return count;
+}
+
+int
+outward_checked(BasicBoard const & board) {
+  int count = 0;
+  board.visit_board([&](Coord coord, CellState) {
+    for (Coord step : {Coord{0, -1}, Coord{0, 1}, Coord{-1, 0}, Coord{1, 0}}) {
+      for (Coord cur = coord + step;; cur = cur + step) {
+        auto cell = board.get_opt_cell(cur);
+        if (not cell) {
+          break;
+        }
+        count += model::is_empty(*cell);
+        if (model::is_wall(*cell)) {
+          break;
+        }
+      }
+    }
+  });
+  return count;
+}
+
+// the number of empty cells in the fullest row segment
+int
+segment_empties_visitor(BasicBoard const & board) {
+  int most  = 0;
+  int count = 0;
+  board.visit_board([&](Coord coord, CellState cell) {
+    if (coord.col_ == 0 || model::is_wall(cell)) {
+      most  = std::max(most, count);
+      count = 0;
+    }
+    count += model::is_empty(cell);
+  });
+  return std::max(most, count);
+}
+
+int
+segment_empties_span(BasicBoard const & board) {
+  int most = 0;
+  board.visit_row_segments([&](Coord, std::span<CellState const> cells) {
+    most = std::max(most, int(std::ranges::count(cells, CellState::EMPTY)));
+  });
+  return most;
+}
+
+} // namespace
+
+int
+main() {
+  int constexpr NUM_BOARDS = 20;
+  int constexpr REPS       = 200;
+
+  for (int size : bench::BOARD_SIZES) {
+    auto const boards = bench::make_boards(size, NUM_BOARDS);
+    if (boards.empty()) {
+      continue;
+    }
+    fmt::print("{}x{} ({} boards)\n", size, size, boards.size());
+
+    auto over_boards = [&](auto && func) {
+      return [&boards, func] {
+        int total = 0;
+        for (auto const & board : boards) {
+          total += func(board);
+        }
+        return total;
+      };
+    };
+    bench::time_it("visit_adjacent", REPS, over_boards(adjacent_visitor));
+    bench::time_it(
+        "adjacent, bounds checked", REPS, over_boards(adjacent_checked));
+    bench::time_it(
+        "visit_rows_cols_outward", REPS, over_boards(outward_visitor));
+    bench::time_it(
+        "outward, bounds checked", REPS, over_boards(outward_checked));
+    bench::time_it("segment empties, cell visitor",
+                   REPS,
+                   over_boards(segment_empties_visitor));
+    bench::time_it(
+        "segment empties, spans", REPS, over_boards(segment_empties_span));
+  }
+}
@@ -0,0 +1,156 @@
+#include "BasicBoard.hpp"
+#include "bench.hpp"
+#include "trivial_moves.hpp"
+#include <algorithm>
+#include <memory>
+#include <random>
+
+// Column scans with and without the column-major mirror of BasicBoard, with
+// the same scans along rows for reference, and the trivial-move rules against
+// the same moves found by walking the lines from each cell.
+
+namespace {
+
+using model::BasicBoard;
+using model::CellState;
+using model::Coord;
+
+// from every cell, scan to the end of its segment
+int
+scan_cols(BasicBoard const & board) {
+  int count = 0;
+  board.visit_board([&](Coord coord, CellState) {
+    board.visit_col_below(coord, [&](Coord, CellState cell) {
+      count += model::is_empty(cell);
+    });
+  });
+  return count;
+}
+
+int
+scan_rows(BasicBoard const & board) {
+  int count = 0;
+  board.visit_board([&](Coord coord, CellState) {
+    board.visit_row_right_of(coord, [&](Coord, CellState cell) {
+      count += model::is_empty(cell);
+    });
+  });
+  return count;
+}
+
+int
+ambiguous_cols(BasicBoard const & board) {
+  solver::AnnotatedMoves moves;
+  solver::find_ambiguous_linear_aligned_col_cells(board, moves);
+  return moves.size();
+}
+
+int
+ambiguous_rows(BasicBoard const & board) {
+  solver::AnnotatedMoves moves;
+  solver::find_ambiguous_linear_aligned_row_cells(board, moves);
+  return moves.size();
+}
+
+int
+trivial_moves(BasicBoard const & board,
+              solver::BoardAnalysis * board_analysis) {
+  solver::AnnotatedMoves moves;
+  solver::find_trivial_moves(board, board_analysis, moves);
+  return moves.size();
+}
+
+// the built-in rules, with the ambiguity checks scanning lines
+int
+trivial_moves_by_line_scans(BasicBoard const &      board,
+                            solver::BoardAnalysis * board_analysis) {
+  solver::AnnotatedMoves moves;
+  solver::find_around_walls_with_deps(board, board_analysis, moves);
+  if (moves.empty()) {
+    solver::find_ambiguous_linear_aligned_row_cells(board, moves);
+  }
+  if (moves.empty()) {
+    solver::find_ambiguous_linear_aligned_col_cells(board, moves);
+  }
+  solver::find_isolated_cells(board, board_analysis, moves);
+  return moves.size();
+}
+
+// The generator is too slow for big boards, so they just get random walls.
+std::vector<BasicBoard>
+make_random_boards(int size, int count) {
+  std::vector<BasicBoard>            boards;
+  std::mt19937                       rng(1);
+  std::uniform_int_distribution<int> percent(0, 99);
+  for (int i = 0; i < count; ++i) {
+    BasicBoard & board = boards.emplace_back(size, size);
+    board.visit_board([&](Coord coord, CellState) {
+      if (percent(rng) < 15) {
+        board.set_cell(coord, CellState::WALL0);
+      }
+    });
+  }
+  return boards;
+}
+
+} // namespace
+
+int
+main() {
+  int constexpr NUM_BOARDS = 20;
+
+  for (int size : {6, 8, 10, 15, 20, 50, 100, 200}) {
+    int const  reps   = std::max(1, 500 * 20 * 20 / (size * size));
+    bool const random = size > 20;
+    auto const boards = random ? make_random_boards(size, NUM_BOARDS)
+                               : bench::make_boards(size, NUM_BOARDS);
+    if (boards.empty()) {
+      continue;
+    }
+    auto mirrored = boards;
+    for (auto & board : mirrored) {
+      board.set_col_major_mirror(true);
+    }
+    fmt::print("{}x{} ({} {} boards)\n",
+               size,
+               size,
+               boards.size(),
+               random ? "random" : "generated");
+
+    auto over = [](auto const & boards, auto && func) {
+      return [&boards, func] {
+        int total = 0;
+        for (auto const & board : boards) {
+          total += func(board);
+        }
+        return total;
+      };
+    };
+    bench::time_it("scan rows", reps, over(boards, scan_rows));
+    bench::time_it("scan cols", reps, over(boards, scan_cols));
+    bench::time_it("scan cols, mirrored", reps, over(mirrored, scan_cols));
+    bench::time_it("ambiguous rows", reps, over(boards, ambiguous_rows));
+    bench::time_it("ambiguous cols", reps, over(boards, ambiguous_cols));
+    bench::time_it(
+        "ambiguous cols, mirrored", reps, over(mirrored, ambiguous_cols));
+
+    // (the analyses are made once per board, as the solver does)
+    std::vector<std::unique_ptr<solver::BoardAnalysis>> analyses;
+    for (auto const & board : boards) {
+      analyses.push_back(solver::create_board_analysis(board));
+    }
+    auto over_analyzed = [&boards, &analyses](auto && func) {
+      return [&boards, &analyses, func] {
+        int total = 0;
+        for (std::size_t i = 0; i < boards.size(); ++i) {
+          total += func(boards[i], analyses[i].get());
+        }
+        return total;
+      };
+    };
+    bench::time_it("trivial moves", reps, over_analyzed(trivial_moves));
+    bench::time_it("trivial moves, line scans",
+                   reps,
+                   over_analyzed(trivial_moves_by_line_scans));
+  }
+}
@@ -0,0 +1,106 @@
+#include "BitboardPosition.hpp"
+#include "PositionBoard.hpp"
+#include "Solver.hpp"
+#include "bench.hpp"
+#include <vector>
+
+// Compares PositionBoard, which walks each ray of light out from a bulb,
+// against BitboardPosition, which ORs together the masks of the segments the
+// bulbs are in.
+
+namespace {
+
+using model::BasicBoard;
+using model::CellState;
+using model::Coord;
+
+// a level, and the bulbs of its solution
+struct Level {
+  BasicBoard         start;
+  BasicBoard         solved;
+  std::vector<Coord> bulbs;
+};
+
+std::vector<Level>
+make_levels(int size, int count) {
+  std::vector<Level> levels;
+  for (BasicBoard const & board : bench::make_boards(size, count)) {
+    auto const solution = solver::solve(board);
+    if (not solution.is_solved()) {
+      continue;
+    }
+    Level & level = levels.emplace_back();
+    level.start   = board;
+    level.solved  = solution.board().board();
+    level.solved.visit_board([&](Coord coord, CellState cell) {
+      if (model::is_bulb(cell)) {
+        level.bulbs.push_back(coord);
+      }
+    });
+  }
+  return levels;
+}
+
+// Plays the bulbs of the solution one at a time, then takes them away again.
+template <solver::PositionEngine PositionT>
+int
+play_solution(Level const & level) {
+  PositionT position(level.start);
+  int       total = 0;
+  for (Coord coord : level.bulbs) {
+    position.add_bulb(coord);
+    total += position.num_walls_with_deps();
+  }
+  total += position.is_solved();
+  for (Coord coord : level.bulbs) {
+    position.remove_bulb(coord);
+    total += position.num_cells_needing_illumination();
+  }
+  return total;
+}
+
+// Builds a position from the solved board, with its light to be recast.
+template <solver::PositionEngine PositionT>
+int
+load_solution(Level const & level) {
+  PositionT const position(level.solved);
+  return position.is_solved();
+}
+
+} // namespace
+
+int
+main() {
+  int constexpr NUM_BOARDS = 20;
+  int constexpr REPS       = 100;
+
+  for (int size : bench::BOARD_SIZES) {
+    auto const levels = make_levels(size, NUM_BOARDS);
+    if (levels.empty()) {
+      continue;
+    }
+    fmt::print("{}x{} ({} levels)\n", size, size, levels.size());
+
+    auto over_levels = [&](auto && func) {
+      return [&levels, func] {
+        int total = 0;
+        for (auto const & level : levels) {
+          total += func(level);
+        }
+        return total;
+      };
+    };
+    bench::time_it("play solution, PositionBoard",
+                   REPS,
+                   over_levels(play_solution<solver::PositionBoard>));
+    bench::time_it("play solution, BitboardPosition",
+                   REPS,
+                   over_levels(play_solution<solver::BitboardPosition>));
+    bench::time_it("load solution, PositionBoard",
+                   REPS,
+                   over_levels(load_solution<solver::PositionBoard>));
+    bench::time_it("load solution, BitboardPosition",
+                   REPS,
+                   over_levels(load_solution<solver::BitboardPosition>));
+  }
+}
@@ -0,0 +1,61 @@
+#include "Solver.hpp"
+#include "bench.hpp"
+#include "trivial_moves.hpp"
+#include <chrono>
+#include <cstdlib>
+
+// Generates and solves a level at sizes well past the ones the game offers,
+// to see how the generator and solver scale with the board area.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double
+ms_since(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+} // namespace
+
+int
+main(int argc, char ** argv) {
+  int const max_size = argc > 1 ? std::atoi(argv[1]) : 100;
+
+  for (int size : {10, 20, 30, 50, 75, 100, 150, 200}) {
+    if (size > max_size) {
+      break;
+    }
+    auto start  = Clock::now();
+    auto boards = bench::make_boards(size, 1);
+    auto gen_ms = ms_since(start);
+    if (boards.empty()) {
+      fmt::print("{0}x{0}: generator failed after {1:.1f} ms\n", size, gen_ms);
+      continue;
+    }
+
+    solver::reset_trivial_move_rule_counters();
+    start         = Clock::now();
+    auto solution = solver::solve(boards.front());
+    auto solve_ms = ms_since(start);
+    fmt::print("{0}x{0}: generate {1:>10.1f} ms, solve {2:>10.1f} ms ({3})\n",
+               size,
+               gen_ms,
+               solve_ms,
+               solution.is_solved() ? "solved" : "unsolved");
+
+#ifdef DEBUGPROFILE
+    // what each deduction rule cost, and how often it found something
+    for (auto const & rule : solver::trivial_move_rules()) {
+      auto const counters = solver::trivial_move_rule_counters(rule);
+      fmt::print(
+          "  {:<25} {:>9} calls {:>9} hits {:>10.1f} ms\n",
+          rule.name,
+          counters.num_calls,
+          counters.num_hits,
+          std::chrono::duration<double, std::milli>(counters.time).count());
+    }
+#endif
+  }
+}
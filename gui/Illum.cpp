@@ -401,8 +401,16 @@ Illum::on_state_change(model::Action    action,
                        model::Coord     coord) {
   if (action == model::Action::REMOVE && prev_state == model::CellState::BULB) {
     bulbs_played_--;
-    position_.reset(model_.get_underlying_board(),
-                    solver::PositionBoard::ResetPolicy::KEEP_ERRORS);
+    position_.remove_bulb(coord);
+
+    // The position replaced any marks the bulb lit with illumination, but the
+    // model kept them, so put back those that are no longer lit.
+    model_.get_underlying_board().visit_rows_cols_outward(
+        coord, [&](model::Coord mark_coord, model::CellState cell) {
+          if (is_mark(cell) && is_empty(position_.get_cell(mark_coord))) {
+            position_.add_mark(mark_coord);
+          }
+        });
   }
   else {
     if (action == model::Action::ADD && to_state == model::CellState::BULB) {
@@ -30,7 +30,7 @@ struct GenContext {
   std::vector<model::Coord>              empty_cells;
   std::unique_ptr<solver::BoardAnalysis> board_analysis =
       solver::create_board_analysis(board.basic_board());
-  solver::AnnotatedMoves annotated_moves;
+  solver::AnnotatedMoves annotated_moves{board.height(), board.width()};
 
   int count_adjacent(model::Coord, model::CellState cell);
 };
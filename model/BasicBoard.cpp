@@ -9,4 +9,39 @@ operator<<(std::ostream & os, BasicBoard const & board) {
   return os;
 }
 
+std::vector<SingleMove>
+diff(BasicBoard const & from, BasicBoard const & to) {
+  if (from.height_ != to.height_ || from.width_ != to.width_) {
+    throw std::runtime_error("Cannot diff boards of different dimensions");
+  }
+
+  std::vector<SingleMove> moves;
+  auto const * from_cells = from.cells_.data();
+  auto const * to_cells   = to.cells_.data();
+  int const    num_bytes  = from.num_cell_bytes();
+  for (int i = 0; i < num_bytes; ++i) {
+    // skip ahead to the next byte that differs
+    i += first_mismatch(from_cells + i, to_cells + i, num_bytes - i);
+    if (i == num_bytes) {
+      break;
+    }
+    // either nibble (or both) of this byte differs. (Border nibbles never do,
+    // since the boards have the same dimensions.)
+    for (int padded_idx : {2 * i, 2 * i + 1}) {
+      std::uint8_t const from_bits = from.get_nibble(padded_idx);
+      std::uint8_t const to_bits   = to.get_nibble(padded_idx);
+      if (from_bits == to_bits) {
+        continue;
+      }
+      CellState const from_cell = from_nibble(from_bits);
+      CellState const to_cell   = from_nibble(to_bits);
+      Coord const     coord{padded_idx / from.stride() - 1,
+                            padded_idx % from.stride() - 1};
+      Action const    action = is_empty(to_cell) ? Action::REMOVE : Action::ADD;
+      moves.push_back(SingleMove{action, from_cell, to_cell, coord});
+    }
+  }
+  return moves;
+}
+
 } // namespace model
@@ -1,7 +1,11 @@
 #pragma once
+#include "BitPlane.hpp"
+#include "ByteCompare.hpp"
 #include "CellState.hpp"
 #include "CellVisitorConcepts.hpp"
 #include "Coord.hpp"
+#include "SingleMove.hpp"
+#include "SmallBuffer.hpp"
 #include "utils/EnumUtils.hpp"
 
 #include <array>
@@ -10,7 +14,9 @@
 #include <fmt/ostream.h>
 #include <iosfwd>
 #include <optional>
+#include <span>
 #include <stdexcept>
+#include <vector>
 
 #ifdef DEBUGPROFILE
 #define DEBUGPROFILE_INC_COUNTER(COUNTER) ++COUNTER
@@ -26,6 +32,13 @@ public:
   static int constexpr MAX_GRID_EDGE = Coord::MAX_GRID_EDGE;
   static int constexpr MAX_CELLS     = MAX_GRID_EDGE * MAX_GRID_EDGE;
 
+  // Cells are stored with a one-cell border on every side, packed two per
+  // byte (see to_nibble). Boards up to INLINE_GRID_EDGE on a side are stored
+  // inline, bigger ones on the heap.
+  static int constexpr INLINE_GRID_EDGE  = 22;
+  static int constexpr INLINE_CELL_BYTES = (INLINE_GRID_EDGE + 2) *
+                                           (INLINE_GRID_EDGE + 2) / 2;
+
   enum class VisitPolicy {
     DEFAULT               = 0,
     VISIT_START_COORD     = 1,
@@ -45,9 +58,20 @@ public:
 
   bool operator==(BasicBoard const & other) const;
 
+  // A Zobrist hash of the dimensions and cells (not the last move), kept
+  // current by every cell change. Equal boards have equal hashes.
+  std::uint64_t hash() const;
+
   void reset(int height, int width);
   bool is_initialized() const;
 
+  // Optionally also keep the cells in column-major order, so that scans along
+  // a column read consecutive cells rather than one per row. Off by default:
+  // when on, every cell change writes both copies, and copying a board copies
+  // both. It stays enabled across reset().
+  void set_col_major_mirror(bool enabled);
+  bool has_col_major_mirror() const;
+
   CellState                get_cell(Coord coord) const;
   std::optional<CellState> get_opt_cell(Coord coord) const;
 
@@ -59,6 +83,11 @@ public:
   int width() const;
   int height() const;
 
+  // Every cell is also indexed in the bit plane of its CellPlane, so counting
+  // or finding cells of a category doesn't require visiting the whole board.
+  BitPlane const & plane(CellPlane) const;
+  int              count(CellPlane) const;
+
   // visitor is invoked for each cell with (row, col, cellstate)
   // visitor may return void or bool:
   //   void == visit all cells              (CellVisitorAll)
@@ -84,6 +113,10 @@ public:
   // visit all currently empty cells (unless prematurely stopped)
   bool visit_empty(CellVisitor auto && visitor) const;
 
+  // visit the cells whose flat index is set in the given plane, in row-major
+  // order. (The plane can be a combination, e.g. bulbs | marks.)
+  bool visit_plane(BitPlane const & cells, CellVisitor auto && visitor) const;
+
   // will stop _after_ visiting a wall, or if visitor returns false
   // Does not visit coord unless VISIT_STARTING_COOED is passed in.
   bool visit_row_left_of(Coord                     coord,
@@ -99,6 +132,16 @@ public:
                        OptDirCellVisitor auto && visitor,
                        VisitPolicy = VisitPolicy::DEFAULT) const;
 
+  // visit every segment (maximal run of non-wall cells) of every row, top to
+  // bottom and left to right, or of every column, left to right and top to
+  // bottom. The visitor gets the coordinate of the first cell and a span of
+  // the cells, which is only valid during the call. The cells are packed as
+  // nibbles, so the span is over a decoded copy of the line, not the board's
+  // storage: it saves the caller no decoding over a cell visitor, but lets a
+  // whole segment be counted or searched with std algorithms in one go.
+  bool visit_row_segments(SegmentVisitor auto && visitor) const;
+  bool visit_col_segments(SegmentVisitor auto && visitor) const;
+
   void visit_perpendicular(Coord                     coord,
                            Direction                 dir,
                            OptDirCellVisitor auto && visitor) const;
@@ -113,6 +156,7 @@ public:
   friend std::ostream & operator<<(std::ostream &, BasicBoard const &);
   CellState             get_cell_flat_unchecked(int) const;
   OptCoord              get_last_move_coord() const;
+  void                  set_last_move_coord(OptCoord);
 
   inline static int visit_cell_counter              = 0;
   inline static int visit_board_counter             = 0;
@@ -125,92 +169,239 @@ public:
   inline static int visit_col_down_counter          = 0;
   inline static int visit_perp_counter              = 0;
   inline static int visit_rows_cols_outward_counter = 0;
+  inline static int visit_segments_counter          = 0;
 
-  // emscripten does not support <=> on std::array<CellState, N>, so cannot use
-  // default. This also avoids comparing the full array for boards that are
-  // smaller than MAX width and height.
-  auto friend
-  operator<=>(BasicBoard const & lhs, BasicBoard const & rhs) {
-    if (auto cmp = lhs.width_ <=> rhs.width_; cmp != 0) {
-      return cmp;
-    }
-    if (auto cmp = lhs.height_ <=> rhs.height_; cmp != 0) {
-      return cmp;
-    }
-    if (auto cmp = lhs.last_move_coord_ <=> rhs.last_move_coord_; cmp != 0) {
-      return cmp;
-    }
-    for (int i = 0, stop = lhs.width_; i < stop;) {
-      if (auto cmp = lhs.cells_[i] <=> rhs.cells_[i]; cmp != 0) {
-        return cmp;
-      }
-    }
-    return std::strong_ordering::equal;
-  }
+  // Boards order by width, then height, then their cells in row-major
+  // order. Like operator==, this ignores the last move coord. Both compare
+  // the packed cells many bytes at a time, and only the bytes this board uses.
+  friend std::strong_ordering
+  operator<=>(BasicBoard const & lhs, BasicBoard const & rhs);
+
+  // The moves that turn board "from" into board "to", one per differing cell
+  // in row-major order: REMOVE if the cell becomes empty, else ADD. Both
+  // boards must have the same dimensions.
+  friend std::vector<SingleMove> diff(BasicBoard const & from,
+                                      BasicBoard const & to);
 
 private:
-  int get_flat_idx(Coord coord) const;
-  int get_flat_idx_unchecked(Coord coord) const;
+  // marks a border cell; never a valid CellState nibble
+  static std::uint8_t constexpr BORDER = 0;
+
+  int num_cell_bytes() const;
+  int stride() const;
+  int col_stride() const;
+
+  int   get_flat_idx_unchecked(Coord coord) const;
+  Coord get_coord_unchecked(int idx) const;
+
+  // Cells are addressed by flat index (row * width + col) in the public API
+  // and in the planes, but by padded index ((row + 1) * stride + col + 1) in
+  // cells_, so that the neighbors of any cell are at constant offsets.
+  int padded_idx(Coord coord) const;
+  int padded_idx(int flat_idx) const;
+
+  // The column-major mirror is laid out the same way with rows and columns
+  // swapped: ((col + 1) * col_stride + row + 1) in col_cells_.
+  int col_padded_idx(Coord coord) const;
 
-  bool
-  visit_cell(Direction, Coord, int idx, CellVisitorSome auto && visitor) const;
+  std::uint8_t get_nibble(int padded_idx) const;
+  void         set_nibble(int padded_idx, std::uint8_t nibble);
 
-  bool
-  visit_cell(Direction, Coord, int idx, CellVisitorAll auto && visitor) const;
+  static std::uint8_t get_nibble(std::uint8_t const * cells, int padded_idx);
+  static void         set_nibble(std::uint8_t * cells,
+                                 int            padded_idx,
+                                 std::uint8_t   nibble);
+
+  void fill_col_major_mirror();
+
+  // all cell writes go through here to keep the planes and hash in sync
+  void update_cell(Coord coord, CellState state);
+
+  // The Zobrist key of a cell state at a flat index. The keys are computed
+  // rather than stored in a table, so they cost no memory for any board size.
+  static std::uint64_t zobrist_key(int idx, std::uint8_t nibble);
+
+  bool visit_cell(Direction,
+                  Coord,
+                  CellState               cell,
+                  CellVisitorSome auto && visitor) const;
+
+  bool visit_cell(Direction,
+                  Coord,
+                  CellState              cell,
+                  CellVisitorAll auto && visitor) const;
 
   bool visit_cell(Direction                       direction,
                   Coord                           coord,
-                  int                             idx,
+                  CellState                       cell,
                   DirectedCellVisitorSome auto && visitor) const;
 
   bool visit_cell(Direction                      direction,
                   Coord                          coord,
-                  int                            idx,
+                  CellState                      cell,
                   DirectedCellVisitorAll auto && visitor) const;
 
-  // a building block for all the visit_(row|col) variations to be assembled
+  // a building block for all the visit_(row|col) variations to be assembled.
+  // The scan ends at the first wall or at the border, so there is no need to
+  // test the coordinates along the way. Column scans read the column-major
+  // mirror when there is one.
   bool visit_straight_line(
-      Direction dir,
-      Coord     coord,
-      auto &&   update_coord, // modify row or col by one
-      auto &&   update_index, // +/- 1 for left/right +/- width for up/down
-      auto &&   test_coord, // check if reached end of range (0 or height/width)
+      Direction                 dir,
+      Coord                     coord,
+      auto &&                   update_coord, // modify row or col by one
+      bool                      along_col,
+      int                       step, // +1 toward higher row/col, else -1
       OptDirCellVisitor auto && visitor,
       VisitPolicy) const;
 
+  bool visit_segments(bool along_col, SegmentVisitor auto && visitor) const;
+
 private:
-  int                              height_ = 0;
-  int                              width_  = 0;
-  std::array<CellState, MAX_CELLS> cells_;
-  OptCoord                         last_move_coord_;
+  int height_ = 0;
+  int width_  = 0;
+
+  // The cell at padded index i is in the high nibble of cells_[i / 2] when i
+  // is even, else in the low nibble. The board is surrounded by BORDER cells,
+  // and when there is an odd number of padded cells the unused low nibble of
+  // the last byte is BORDER too, so the used bytes can be compared wholesale.
+  //
+  // Copying a board copies only the bytes (and plane words) that hold its
+  // cells, so copying a small board is much cheaper than copying a big one.
+  SmallBuffer<std::uint8_t, INLINE_CELL_BYTES> cells_;
+  std::array<BitPlane, NUM_CELL_PLANES>        planes_;
+  std::uint64_t                                hash_ = 0;
+  OptCoord                                     last_move_coord_;
+
+  // empty unless col_major_mirror_ (see set_col_major_mirror)
+  bool                                         col_major_mirror_ = false;
+  SmallBuffer<std::uint8_t, INLINE_CELL_BYTES> col_cells_;
 };
 
+inline int
+BasicBoard::num_cell_bytes() const {
+  return ((height_ + 2) * stride() + 1) / 2;
+}
+
+inline int
+BasicBoard::stride() const {
+  return width_ + 2;
+}
+
+inline int
+BasicBoard::col_stride() const {
+  return height_ + 2;
+}
+
 inline bool
 BasicBoard::operator==(BasicBoard const & other) const {
   if (height_ != other.height_ || width_ != other.width_) {
     return false;
   }
-  for (int i = 0, e = height_ * width_; i < e; ++i) {
-    if (cells_[i] != other.cells_[i]) {
-      return false;
-    }
+  int const num_bytes = num_cell_bytes();
+  return first_mismatch(cells_.data(), other.cells_.data(), num_bytes) ==
+         num_bytes;
+}
+
+std::vector<SingleMove> diff(BasicBoard const & from, BasicBoard const & to);
+
+inline std::strong_ordering
+operator<=>(BasicBoard const & lhs, BasicBoard const & rhs) {
+  if (auto cmp = lhs.width_ <=> rhs.width_; cmp != 0) {
+    return cmp;
   }
-  return true;
+  if (auto cmp = lhs.height_ <=> rhs.height_; cmp != 0) {
+    return cmp;
+  }
+  // The lower-indexed cell of each byte is in its high nibble, and nibbles
+  // increase with the CellState values, so comparing bytes compares cells.
+  int const num_bytes = lhs.num_cell_bytes();
+  int const idx =
+      first_mismatch(lhs.cells_.data(), rhs.cells_.data(), num_bytes);
+  if (idx == num_bytes) {
+    return std::strong_ordering::equal;
+  }
+  return lhs.cells_[idx] <=> rhs.cells_[idx];
+}
+
+inline std::uint64_t
+BasicBoard::hash() const {
+  return hash_;
+}
+
+inline std::uint64_t
+BasicBoard::zobrist_key(int idx, std::uint8_t nibble) {
+  // splitmix64 finalizer
+  std::uint64_t key = (std::uint64_t(idx) << CellState_ORDINAL_BITS) | nibble;
+  key += 0x9e3779b97f4a7c15;
+  key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9;
+  key = (key ^ (key >> 27)) * 0x94d049bb133111eb;
+  return key ^ (key >> 31);
 }
 
 inline void
 BasicBoard::reset(int height, int width) {
   assert(height > 0);
   assert(width > 0);
-  for (auto & cell : cells_) {
-    cell = CellState::EMPTY;
+  if (height < 0 || width < 0 || height > MAX_GRID_EDGE ||
+      width > MAX_GRID_EDGE) {
+    throw std::runtime_error("Invalid dimensions");
   }
   height_ = height;
   width_  = width;
-  if (height_ < 0 || width_ < 0 || height_ * width_ >= cells_.size()) {
-    throw std::runtime_error("Invalid dimensions");
+
+  cells_.resize(num_cell_bytes());
+  std::fill_n(cells_.data(), num_cell_bytes(), BORDER);
+  for (int row = 0; row < height_; ++row) {
+    for (int i = padded_idx(Coord{row, 0}), e = i + width_; i < e; ++i) {
+      set_nibble(i, to_nibble(CellState::EMPTY));
+    }
+  }
+
+  for (auto & plane : planes_) {
+    plane.resize(height_ * width_);
+  }
+  planes_[+CellPlane::EMPTY].set_all();
+
+  // the border nibble is not a cell state, so its keys are free to stand in
+  // for the dimensions
+  hash_ = zobrist_key(height_ * (MAX_GRID_EDGE + 1) + width_, BORDER);
+  for (int idx = 0, e = height_ * width_; idx < e; ++idx) {
+    hash_ ^= zobrist_key(idx, to_nibble(CellState::EMPTY));
   }
   last_move_coord_.reset();
+
+  if (col_major_mirror_) {
+    fill_col_major_mirror();
+  }
+}
+
+inline void
+BasicBoard::set_col_major_mirror(bool enabled) {
+  col_major_mirror_ = enabled;
+  if (enabled) {
+    fill_col_major_mirror();
+  }
+  else {
+    col_cells_.resize(0);
+  }
+}
+
+inline bool
+BasicBoard::has_col_major_mirror() const {
+  return col_major_mirror_;
+}
+
+inline void
+BasicBoard::fill_col_major_mirror() {
+  col_cells_.resize(num_cell_bytes());
+  std::fill_n(col_cells_.data(), num_cell_bytes(), BORDER);
+  for (int row = 0; row < height_; ++row) {
+    for (int col = 0; col < width_; ++col) {
+      Coord const        coord{row, col};
+      std::uint8_t const nibble = get_nibble(padded_idx(coord));
+      set_nibble(col_cells_.data(), col_padded_idx(coord), nibble);
+    }
+  }
 }
 
 inline bool
@@ -220,23 +411,23 @@ BasicBoard::is_initialized() const {
 
 inline CellState
 BasicBoard::get_cell(Coord coord) const {
-  if (int idx = get_flat_idx(coord); idx != -1) {
-    return cells_[idx];
+  if (coord.in_range(height_, width_)) {
+    return from_nibble(get_nibble(padded_idx(coord)));
   }
   throw std::range_error("Out of bounds");
 }
 
 inline std::optional<CellState>
 BasicBoard::get_opt_cell(Coord coord) const {
-  if (int idx = get_flat_idx(coord); idx != -1) {
-    return cells_[idx];
+  if (coord.in_range(height_, width_)) {
+    return from_nibble(get_nibble(padded_idx(coord)));
   }
   return std::nullopt;
 }
 
 inline CellState
 BasicBoard::get_cell_flat_unchecked(int idx) const {
-  return cells_[idx];
+  return from_nibble(get_nibble(padded_idx(idx)));
 }
 
 inline OptCoord
@@ -244,10 +435,15 @@ BasicBoard::get_last_move_coord() const {
   return last_move_coord_;
 }
 
+inline void
+BasicBoard::set_last_move_coord(OptCoord coord) {
+  last_move_coord_ = coord;
+}
+
 inline bool
 BasicBoard::set_cell(Coord coord, CellState state) {
-  if (auto idx = get_flat_idx(coord); idx != -1) {
-    cells_[idx] = state;
+  if (coord.in_range(height_, width_)) {
+    update_cell(coord, state);
     if (is_playable(state)) {
       last_move_coord_ = coord;
     }
@@ -259,24 +455,79 @@ BasicBoard::set_cell(Coord coord, CellState state) {
 template <typename PredT>
 bool
 BasicBoard::set_cell_if(Coord coord, CellState state, PredT pred) {
-  if (auto idx = get_flat_idx(coord); idx > -1 && pred(cells_[idx])) {
-    cells_[idx] = state;
+  if (coord.in_range(height_, width_) &&
+      pred(from_nibble(get_nibble(padded_idx(coord))))) {
+    update_cell(coord, state);
     return true;
   }
   return false;
 }
 
+inline void
+BasicBoard::update_cell(Coord coord, CellState state) {
+  int const          idx        = get_flat_idx_unchecked(coord);
+  int const          pidx       = padded_idx(coord);
+  std::uint8_t const old_nibble = get_nibble(pidx);
+  std::uint8_t const new_nibble = to_nibble(state);
+  planes_[+plane_of(from_nibble(old_nibble))].reset(idx);
+  planes_[+plane_of(state)].set(idx);
+  hash_ ^= zobrist_key(idx, old_nibble) ^ zobrist_key(idx, new_nibble);
+  set_nibble(pidx, new_nibble);
+  if (col_major_mirror_) {
+    set_nibble(col_cells_.data(), col_padded_idx(coord), new_nibble);
+  }
+}
+
+inline int
+BasicBoard::padded_idx(Coord coord) const {
+  return (coord.row_ + 1) * stride() + coord.col_ + 1;
+}
+
+inline int
+BasicBoard::padded_idx(int flat_idx) const {
+  return flat_idx + 2 * (flat_idx / width_) + stride() + 1;
+}
+
+inline int
+BasicBoard::col_padded_idx(Coord coord) const {
+  return (coord.col_ + 1) * col_stride() + coord.row_ + 1;
+}
+
+inline std::uint8_t
+BasicBoard::get_nibble(int padded_idx) const {
+  assert(padded_idx >= 0 && padded_idx < 2 * cells_.size());
+  return get_nibble(cells_.data(), padded_idx);
+}
+
+inline void
+BasicBoard::set_nibble(int padded_idx, std::uint8_t nibble) {
+  assert(padded_idx >= 0 && padded_idx < 2 * cells_.size());
+  set_nibble(cells_.data(), padded_idx, nibble);
+}
+
+inline std::uint8_t
+BasicBoard::get_nibble(std::uint8_t const * cells, int padded_idx) {
+  int const shift = (~padded_idx & 1) << 2;
+  return (cells[padded_idx >> 1] >> shift) & 0xF;
+}
+
+inline void
+BasicBoard::set_nibble(std::uint8_t * cells,
+                       int            padded_idx,
+                       std::uint8_t   nibble) {
+  int const      shift = (~padded_idx & 1) << 2;
+  std::uint8_t & byte  = cells[padded_idx >> 1];
+  byte = (byte & ~(0xF << shift)) | (nibble << shift);
+}
+
 inline int
 BasicBoard::get_flat_idx_unchecked(Coord coord) const {
   return coord.row_ * width_ + coord.col_;
 }
 
-inline int
-BasicBoard::get_flat_idx(Coord coord) const {
-  if (coord.in_range(height_, width_)) {
-    return get_flat_idx_unchecked(coord);
-  }
-  return -1;
+inline Coord
+BasicBoard::get_coord_unchecked(int idx) const {
+  return {idx / width_, idx % width_};
 }
 
 inline int
@@ -289,45 +540,51 @@ BasicBoard::height() const {
   return height_;
 }
 
+inline BitPlane const &
+BasicBoard::plane(CellPlane cell_plane) const {
+  return planes_[+cell_plane];
+}
+
+inline int
+BasicBoard::count(CellPlane cell_plane) const {
+  return planes_[+cell_plane].count();
+}
+
 inline bool
 BasicBoard::visit_cell(Direction               direction,
                        Coord                   coord,
-                       int                     i,
+                       CellState               cell,
                        CellVisitorSome auto && visitor) const {
   DEBUGPROFILE_INC_COUNTER(visit_cell_counter);
-  assert(get_flat_idx(coord) == i);
-  return visitor(coord, cells_[i]) == model::KEEP_VISITING;
+  return visitor(coord, cell) == model::KEEP_VISITING;
 }
 
 inline bool
 BasicBoard::visit_cell(Direction              direction,
                        Coord                  coord,
-                       int                    i,
+                       CellState              cell,
                        CellVisitorAll auto && visitor) const {
   DEBUGPROFILE_INC_COUNTER(visit_cell_counter);
-  assert(get_flat_idx(coord) == i);
-  visitor(coord, cells_[i]);
+  visitor(coord, cell);
   return true;
 }
 
 inline bool
 BasicBoard::visit_cell(Direction                       direction,
                        Coord                           coord,
-                       int                             i,
+                       CellState                       cell,
                        DirectedCellVisitorSome auto && visitor) const {
   DEBUGPROFILE_INC_COUNTER(visit_cell_counter);
-  assert(get_flat_idx(coord) == i);
-  return visitor(direction, coord, cells_[i]) == KEEP_VISITING;
+  return visitor(direction, coord, cell) == KEEP_VISITING;
 }
 
 inline bool
 BasicBoard::visit_cell(Direction                      direction,
                        Coord                          coord,
-                       int                            i,
+                       CellState                      cell,
                        DirectedCellVisitorAll auto && visitor) const {
   DEBUGPROFILE_INC_COUNTER(visit_cell_counter);
-  assert(get_flat_idx(coord) == i);
-  visitor(direction, coord, cells_[i]);
+  visitor(direction, coord, cell);
   return true;
 }
 
@@ -335,16 +592,19 @@ inline bool
 BasicBoard::visit_adjacent(Coord                     coord,
                            OptDirCellVisitor auto && visitor) const {
   DEBUGPROFILE_INC_COUNTER(visit_adjacent_counter);
-  auto visit = [&](Coord coord) {
-    if (int idx = get_flat_idx(coord); idx != -1) {
-      return visit_cell(Direction::NONE, coord, idx, visitor);
-    }
-    return true;
+  assert(coord.in_range(height_, width_));
+  int const pidx = padded_idx(coord);
+  auto      visit = [&](int adj_pidx, Coord adj_coord) {
+    std::uint8_t const nibble = get_nibble(adj_pidx);
+    return nibble == BORDER ||
+           visit_cell(Direction::NONE, adj_coord, from_nibble(nibble), visitor);
   };
 
   auto [row, col] = coord;
-  return visit({row - 1, col}) && visit({row, col - 1}) &&
-         visit({row + 1, col}) && visit({row, col + 1});
+  return visit(pidx - stride(), {row - 1, col}) &&
+         visit(pidx - 1, {row, col - 1}) &&
+         visit(pidx + stride(), {row + 1, col}) &&
+         visit(pidx + 1, {row, col + 1});
 }
 
 inline bool
@@ -352,46 +612,57 @@ BasicBoard::visit_adj_flank(Coord                     coord,
                             Direction                 dir,
                             OptDirCellVisitor auto && visitor) const {
   DEBUGPROFILE_INC_COUNTER(visit_adj_flank_counter);
-  auto visit = [&](Direction dir, Coord coord) {
-    if (int idx = get_flat_idx(coord); idx != -1) {
-      return visit_cell(dir, coord, idx, visitor);
-    }
-    return true;
+  assert(coord.in_range(height_, width_));
+  int const pidx  = padded_idx(coord);
+  auto      visit = [&](Direction dir, int adj_pidx, Coord adj_coord) {
+    std::uint8_t const nibble = get_nibble(adj_pidx);
+    return nibble == BORDER ||
+           visit_cell(dir, adj_coord, from_nibble(nibble), visitor);
   };
 
   auto [row, col] = coord;
   if (dir == Direction::UP || dir == Direction::DOWN) {
-    return visit(Direction::LEFT, {row, col - 1}) &&
-           visit(Direction::RIGHT, {row, col + 1});
+    return visit(Direction::LEFT, pidx - 1, {row, col - 1}) &&
+           visit(Direction::RIGHT, pidx + 1, {row, col + 1});
   }
   else {
-    return visit(Direction::UP, {row - 1, col}) &&
-           visit(Direction::DOWN, {row + 1, col});
+    return visit(Direction::UP, pidx - stride(), {row - 1, col}) &&
+           visit(Direction::DOWN, pidx + stride(), {row + 1, col});
   }
 }
 
 inline bool
 BasicBoard::visit_empty(CellVisitor auto && visitor) const {
   DEBUGPROFILE_INC_COUNTER(visit_empty_counter);
-  return visit_board_if(visitor,
-                        [](auto, CellState cell) { return is_empty(cell); });
+  return visit_plane(plane(CellPlane::EMPTY), visitor);
+}
+
+inline bool
+BasicBoard::visit_plane(BitPlane const &    cells,
+                        CellVisitor auto && visitor) const {
+  return cells.visit_set_bits([&](int idx) {
+    Coord const     coord = get_coord_unchecked(idx);
+    CellState const cell  = from_nibble(get_nibble(padded_idx(coord)));
+    return visit_cell(Direction::NONE, coord, cell, visitor) ? KEEP_VISITING
+                                                             : STOP_VISITING;
+  });
 }
 
 inline bool
 BasicBoard::visit_board_if(CellVisitor auto &&        visitor,
                            CellVisitPredicate auto && visit_cell_pred) const {
   DEBUGPROFILE_INC_COUNTER(visit_board_counter);
-  for (int r = 0, c = 0, i = 0; r < height_; ++i) {
-    Coord coord{r, c};
-    if (visit_cell_pred(coord, cells_[i])) {
-      if (not visit_cell(Direction::NONE, coord, i, visitor)) {
-        return false;
+  for (int r = 0; r < height_; ++r) {
+    int const row_start = padded_idx(Coord{r, 0});
+    for (int c = 0; c < width_; ++c) {
+      Coord const     coord{r, c};
+      CellState const cell = from_nibble(get_nibble(row_start + c));
+      if (visit_cell_pred(coord, cell)) {
+        if (not visit_cell(Direction::NONE, coord, cell, visitor)) {
+          return false;
+        }
       }
     }
-    if (++c == width_) {
-      c = 0;
-      ++r;
-    }
   }
   return true;
 }
@@ -405,8 +676,8 @@ inline bool
 BasicBoard::visit_straight_line(Direction                 dir,
                                 Coord                     coord,
                                 auto &&                   update_coord,
-                                auto &&                   update_index,
-                                auto &&                   test_coord,
+                                bool                      along_col,
+                                int                       step,
                                 OptDirCellVisitor auto && visitor,
                                 BasicBoard::VisitPolicy   visit_policy) const {
   // initial movement normally skips the starting point, since we are scanning
@@ -416,26 +687,35 @@ BasicBoard::visit_straight_line(Direction                 dir,
     update_coord(coord);
   }
 
-  int idx = get_flat_idx(coord);
-  if (idx < 0) {
+  if (not coord.in_range(height_, width_)) {
     return true;
   }
   bool const should_visit_wall =
       (+visit_policy & +VisitPolicy::SKIP_TERMINATING_WALL) == 0;
 
-  while (test_coord(coord)) {
-    bool const hit_wall = is_wall(cells_[idx]);
+  // a column of the mirror is contiguous, like a row of cells_
+  bool const                 use_mirror = along_col && col_major_mirror_;
+  std::uint8_t const * const cells =
+      use_mirror ? col_cells_.data() : cells_.data();
+  int const idx_step = along_col && not use_mirror ? step * stride() : step;
+
+  for (int idx = use_mirror ? col_padded_idx(coord) : padded_idx(coord);;
+       idx += idx_step) {
+    std::uint8_t const nibble = get_nibble(cells, idx);
+    if (nibble == BORDER) {
+      break;
+    }
+    CellState const cell     = from_nibble(nibble);
+    bool const      hit_wall = is_wall(cell);
     if (not hit_wall || should_visit_wall) {
-      if (not visit_cell(dir, coord, idx, visitor)) {
+      if (not visit_cell(dir, coord, cell, visitor)) {
         return false;
       }
     }
     if (hit_wall) {
       break;
     }
-    // post iteration update.  Change coord, compute new flat index
     update_coord(coord);
-    update_index(idx);
   }
   return true;
 }
@@ -446,13 +726,11 @@ BasicBoard::visit_row_left_of(Coord                     coord,
                               VisitPolicy               visit_policy) const {
   DEBUGPROFILE_INC_COUNTER(visit_row_left_counter);
   auto update_coord = [](Coord & coord) { --coord.col_; };
-  auto update_idx   = [](int & idx) { --idx; };
-  auto test_coord   = [](Coord coord) { return coord.col_ >= 0; };
   return visit_straight_line(Direction::LEFT,
                              coord,
                              update_coord,
-                             update_idx,
-                             test_coord,
+                             false,
+                             -1,
                              visitor,
                              visit_policy);
 }
@@ -463,13 +741,11 @@ BasicBoard::visit_row_right_of(Coord                     coord,
                                VisitPolicy               visit_policy) const {
   DEBUGPROFILE_INC_COUNTER(visit_row_right_counter);
   auto update_coord = [](Coord & coord) { ++coord.col_; };
-  auto update_idx   = [](int & idx) { ++idx; };
-  auto test_coord   = [w = width_](Coord coord) { return coord.col_ < w; };
   return visit_straight_line(Direction::RIGHT,
                              coord,
                              update_coord,
-                             update_idx,
-                             test_coord,
+                             false,
+                             1,
                              visitor,
                              visit_policy);
 }
@@ -480,13 +756,11 @@ BasicBoard::visit_col_above(Coord                     coord,
                             VisitPolicy               visit_policy) const {
   DEBUGPROFILE_INC_COUNTER(visit_col_up_counter);
   auto update_coord = [](Coord & coord) { --coord.row_; };
-  auto update_idx   = [w = width_](int & idx) { idx -= w; };
-  auto test_coord   = [](Coord coord) { return coord.row_ >= 0; };
   return visit_straight_line(Direction::UP,
                              coord,
                              update_coord,
-                             update_idx,
-                             test_coord,
+                             true,
+                             -1,
                              visitor,
                              visit_policy);
 }
@@ -497,17 +771,77 @@ BasicBoard::visit_col_below(Coord                     coord,
                             VisitPolicy               visit_policy) const {
   DEBUGPROFILE_INC_COUNTER(visit_col_down_counter);
   auto update_coord = [](Coord & coord) { ++coord.row_; };
-  auto update_idx   = [w = width_](int & idx) { idx += w; };
-  auto test_coord   = [h = height_](Coord coord) { return coord.row_ < h; };
   return visit_straight_line(Direction::DOWN,
                              coord,
                              update_coord,
-                             update_idx,
-                             test_coord,
+                             true,
+                             1,
                              visitor,
                              visit_policy);
 }
 
+inline bool
+BasicBoard::visit_segments(bool                   along_col,
+                           SegmentVisitor auto && visitor) const {
+  DEBUGPROFILE_INC_COUNTER(visit_segments_counter);
+  bool const                 use_mirror = along_col && col_major_mirror_;
+  std::uint8_t const * const cells =
+      use_mirror ? col_cells_.data() : cells_.data();
+  int const num_lines = along_col ? width_ : height_;
+  int const length    = along_col ? height_ : width_;
+  int const idx_step  = along_col && not use_mirror ? stride() : 1;
+
+  // Each line is decoded into line_cells, and each segment is handed out as
+  // soon as the wall (or border) ending it is reached.
+  auto const visit = [&](Coord start, CellState const * first, int size) {
+    std::span<CellState const> const segment{first, std::size_t(size)};
+    if constexpr (SegmentVisitorSome<decltype(visitor)>) {
+      return visitor(start, segment) == KEEP_VISITING;
+    }
+    else {
+      visitor(start, segment);
+      return true;
+    }
+  };
+  std::array<CellState, MAX_GRID_EDGE> line_cells;
+  for (int line = 0; line < num_lines; ++line) {
+    Coord const first = along_col ? Coord{0, line} : Coord{line, 0};
+    int         idx   = use_mirror ? col_padded_idx(first) : padded_idx(first);
+    int         begin = 0;
+    for (int pos = 0; pos < length; ++pos, idx += idx_step) {
+      CellState const cell = from_nibble(get_nibble(cells, idx));
+      line_cells[pos]      = cell;
+      if (is_wall(cell)) {
+        if (pos > begin) {
+          Coord const start = along_col ? Coord{begin, line}
+                                        : Coord{line, begin};
+          if (not visit(start, line_cells.data() + begin, pos - begin)) {
+            return false;
+          }
+        }
+        begin = pos + 1;
+      }
+    }
+    if (length > begin) {
+      Coord const start = along_col ? Coord{begin, line} : Coord{line, begin};
+      if (not visit(start, line_cells.data() + begin, length - begin)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+inline bool
+BasicBoard::visit_row_segments(SegmentVisitor auto && visitor) const {
+  return visit_segments(false, visitor);
+}
+
+inline bool
+BasicBoard::visit_col_segments(SegmentVisitor auto && visitor) const {
+  return visit_segments(true, visitor);
+}
+
 inline void
 BasicBoard::visit_rows_cols_outward(Coord                     coord,
                                     OptDirCellVisitor auto && visitor,
@@ -563,6 +897,14 @@ BasicBoard::visit_perpendicular(Coord                     coord,
 
 } // namespace model
 
+template <>
+struct std::hash<::model::BasicBoard> {
+  size_t
+  operator()(::model::BasicBoard const & board) const {
+    return board.hash();
+  }
+};
+
 template <>
 struct fmt::formatter<::model::BasicBoard> {
 
@@ -0,0 +1,240 @@
+#pragma once
+
+#include "CellVisitorConcepts.hpp"
+#include "Coord.hpp"
+#include "SmallBuffer.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <concepts>
+#include <cstdint>
+
+namespace model {
+
+// A set of flat cell indices, one bit per cell. BasicBoard keeps one plane
+// per broad category of cell (see CellPlane) so whole-board questions such as
+// "are there any empty cells?" or "how many bulbs are there?" become popcounts
+// over a few words, rather than visiting every cell.
+//
+// A plane is sized to the board it indexes, and only the words covering that
+// size are ever read or copied, so small boards stay cheap to copy. Planes of
+// up to INLINE_WORDS words need no heap storage.
+class BitPlane {
+public:
+  using Word = std::uint64_t;
+
+  static int constexpr WORD_BITS = 64;
+  static int constexpr MAX_BITS  = Coord::MAX_GRID_EDGE * Coord::MAX_GRID_EDGE;
+
+  // enough for a 22x22 board
+  static int constexpr INLINE_WORDS = 8;
+
+  BitPlane() = default;
+  explicit BitPlane(int num_bits) { resize(num_bits); }
+
+  // clears every bit, and sets the size of the plane
+  void resize(int num_bits);
+  int  size() const;
+
+  void set(int idx);
+  void reset(int idx);
+  bool test(int idx) const;
+
+  void set_all();
+  void clear();
+
+  // Word by word access, for sets of cells kept as the words they're in: bit
+  // i of word word_idx is bit word_idx * WORD_BITS + i. set_bits sets those
+  // of bits, which must be within the size of the plane.
+  Word word(int word_idx) const;
+  void set_bits(int word_idx, Word bits);
+
+  int  count() const;
+  bool any() const;
+  bool none() const;
+
+  // the number of bits set in both this and other, which must be the same size
+  int count_common(BitPlane const & other) const;
+
+  // both planes must be the same size
+  BitPlane & operator|=(BitPlane const & other);
+  BitPlane & operator&=(BitPlane const & other);
+  BitPlane & operator^=(BitPlane const & other);
+
+  friend BitPlane
+  operator|(BitPlane lhs, BitPlane const & rhs) {
+    return lhs |= rhs;
+  }
+
+  friend BitPlane
+  operator&(BitPlane lhs, BitPlane const & rhs) {
+    return lhs &= rhs;
+  }
+
+  friend BitPlane
+  operator^(BitPlane lhs, BitPlane const & rhs) {
+    return lhs ^= rhs;
+  }
+
+  bool operator==(BitPlane const & other) const;
+
+  // visitor is invoked with the index of each set bit, in increasing order.
+  // visitor may return void (visit all) or VisitStatus (may stop early.)
+  // Returns false if the visit was stopped prematurely.
+  template <typename VisitorT>
+  bool visit_set_bits(VisitorT && visitor) const;
+
+private:
+  int                             num_bits_  = 0;
+  int                             num_words_ = 0;
+  SmallBuffer<Word, INLINE_WORDS> words_;
+};
+
+inline void
+BitPlane::resize(int num_bits) {
+  assert(num_bits >= 0 && num_bits <= MAX_BITS);
+  num_bits_  = num_bits;
+  num_words_ = (num_bits + WORD_BITS - 1) / WORD_BITS;
+  words_.resize(num_words_);
+  clear();
+}
+
+inline int
+BitPlane::size() const {
+  return num_bits_;
+}
+
+inline void
+BitPlane::set(int idx) {
+  assert(idx >= 0 && idx < num_bits_);
+  words_[idx / WORD_BITS] |= Word{1} << (idx % WORD_BITS);
+}
+
+inline void
+BitPlane::reset(int idx) {
+  assert(idx >= 0 && idx < num_bits_);
+  words_[idx / WORD_BITS] &= ~(Word{1} << (idx % WORD_BITS));
+}
+
+inline bool
+BitPlane::test(int idx) const {
+  assert(idx >= 0 && idx < num_bits_);
+  return (words_[idx / WORD_BITS] >> (idx % WORD_BITS)) & 1;
+}
+
+inline void
+BitPlane::set_all() {
+  std::fill_n(words_.data(), num_words_, ~Word{0});
+  if (int const extra = num_bits_ % WORD_BITS; extra > 0) {
+    // bits beyond the size of the plane must remain clear
+    words_[num_words_ - 1] = (Word{1} << extra) - 1;
+  }
+}
+
+inline void
+BitPlane::clear() {
+  std::fill_n(words_.data(), num_words_, Word{0});
+}
+
+inline BitPlane::Word
+BitPlane::word(int word_idx) const {
+  assert(word_idx >= 0 && word_idx < num_words_);
+  return words_[word_idx];
+}
+
+inline void
+BitPlane::set_bits(int word_idx, Word bits) {
+  assert(word_idx >= 0 && word_idx < num_words_);
+  assert(word_idx < num_bits_ / WORD_BITS ||
+         (bits >> (num_bits_ % WORD_BITS)) == 0);
+  words_[word_idx] |= bits;
+}
+
+inline int
+BitPlane::count() const {
+  int total = 0;
+  for (int i = 0; i < num_words_; ++i) {
+    total += __builtin_popcountll(words_[i]);
+  }
+  return total;
+}
+
+inline bool
+BitPlane::any() const {
+  for (int i = 0; i < num_words_; ++i) {
+    if (words_[i] != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+inline bool
+BitPlane::none() const {
+  return not any();
+}
+
+inline int
+BitPlane::count_common(BitPlane const & other) const {
+  assert(num_bits_ == other.num_bits_);
+  int total = 0;
+  for (int i = 0; i < num_words_; ++i) {
+    total += __builtin_popcountll(words_[i] & other.words_[i]);
+  }
+  return total;
+}
+
+inline BitPlane &
+BitPlane::operator|=(BitPlane const & other) {
+  assert(num_bits_ == other.num_bits_);
+  for (int i = 0; i < num_words_; ++i) {
+    words_[i] |= other.words_[i];
+  }
+  return *this;
+}
+
+inline BitPlane &
+BitPlane::operator&=(BitPlane const & other) {
+  assert(num_bits_ == other.num_bits_);
+  for (int i = 0; i < num_words_; ++i) {
+    words_[i] &= other.words_[i];
+  }
+  return *this;
+}
+
+inline BitPlane &
+BitPlane::operator^=(BitPlane const & other) {
+  assert(num_bits_ == other.num_bits_);
+  for (int i = 0; i < num_words_; ++i) {
+    words_[i] ^= other.words_[i];
+  }
+  return *this;
+}
+
+inline bool
+BitPlane::operator==(BitPlane const & other) const {
+  return num_bits_ == other.num_bits_ &&
+         std::equal(
+             words_.data(), words_.data() + num_words_, other.words_.data());
+}
+
+template <typename VisitorT>
+bool
+BitPlane::visit_set_bits(VisitorT && visitor) const {
+  for (int i = 0; i < num_words_; ++i) {
+    for (Word word = words_[i]; word != 0; word &= word - 1) {
+      int const idx = i * WORD_BITS + __builtin_ctzll(word);
+      if constexpr (std::same_as<decltype(visitor(idx)), VisitStatus>) {
+        if (visitor(idx) == STOP_VISITING) {
+          return false;
+        }
+      }
+      else {
+        visitor(idx);
+      }
+    }
+  }
+  return true;
+}
+
+} // namespace model
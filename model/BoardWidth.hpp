@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Coord.hpp"
+
+namespace model {
+
+// The width of a board, for kernels that work on flat cell indices. A kernel
+// templated on the width type gets compile-time strides, loop bounds, and
+// division by the width when instantiated with FixedWidth, and still works
+// for any board with DynamicWidth.
+
+template <int W>
+struct FixedWidth {
+  static_assert(W > 0 && W <= Coord::MAX_GRID_EDGE);
+
+  static constexpr int
+  value() {
+    return W;
+  }
+};
+
+struct DynamicWidth {
+  int width_;
+
+  constexpr int
+  value() const {
+    return width_;
+  }
+};
+
+template <typename WidthT>
+constexpr Coord
+coord_of(int flat_idx, WidthT width) {
+  return {flat_idx / width.value(), flat_idx % width.value()};
+}
+
+template <typename WidthT>
+constexpr int
+flat_idx_of(Coord coord, WidthT width) {
+  return coord.row_ * width.value() + coord.col_;
+}
+
+// Invoke func with a FixedWidth for the sizes the game generates (see
+// Illum::BOARD_SIZES), else with a DynamicWidth.
+template <typename FuncT>
+decltype(auto)
+with_board_width(int width, FuncT && func) {
+  switch (width) {
+    case 6:
+      return func(FixedWidth<6>{});
+    case 8:
+      return func(FixedWidth<8>{});
+    case 10:
+      return func(FixedWidth<10>{});
+    case 15:
+      return func(FixedWidth<15>{});
+    case 20:
+      return func(FixedWidth<20>{});
+    default:
+      return func(DynamicWidth{width});
+  }
+}
+
+} // namespace model
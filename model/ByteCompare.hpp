@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace model {
+
+// Returns the index of the first byte where lhs and rhs differ, or size if
+// they are equal. Compares 32 (AVX2) or 16 (SSE2) bytes at a time where the
+// target supports it, else 8 at a time with plain integer compares.
+inline int
+first_mismatch(std::uint8_t const * lhs, std::uint8_t const * rhs, int size) {
+  int i = 0;
+#if defined(__AVX2__)
+  for (; i + 32 <= size; i += 32) {
+    auto const a =
+        _mm256_loadu_si256(reinterpret_cast<__m256i const *>(lhs + i));
+    auto const b =
+        _mm256_loadu_si256(reinterpret_cast<__m256i const *>(rhs + i));
+    unsigned const same = _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+    if (same != 0xFFFFFFFF) {
+      return i + __builtin_ctz(~same);
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  for (; i + 16 <= size; i += 16) {
+    auto const a = _mm_loadu_si128(reinterpret_cast<__m128i const *>(lhs + i));
+    auto const b = _mm_loadu_si128(reinterpret_cast<__m128i const *>(rhs + i));
+    unsigned const same = _mm_movemask_epi8(_mm_cmpeq_epi8(a, b));
+    if (same != 0xFFFF) {
+      return i + __builtin_ctz(~same);
+    }
+  }
+#endif
+  for (; i + 8 <= size; i += 8) {
+    std::uint64_t a, b;
+    std::memcpy(&a, lhs + i, sizeof(a));
+    std::memcpy(&b, rhs + i, sizeof(b));
+    if (a != b) {
+      break; // the byte loop below finds which one
+    }
+  }
+  for (; i < size; ++i) {
+    if (lhs[i] != rhs[i]) {
+      return i;
+    }
+  }
+  return size;
+}
+
+} // namespace model
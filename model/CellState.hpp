@@ -159,6 +159,45 @@ wall_with_deps(int num_deps) {
   }
 }
 
+// Broad categories of cells, each indexed by its own BitPlane in BasicBoard.
+// All the walls share a plane regardless of their deps.
+enum class CellPlane : std::uint8_t { WALL, EMPTY, BULB, MARK, ILLUM };
+constexpr int NUM_CELL_PLANES = 5;
+
+constexpr int
+operator+(CellPlane cell_plane) {
+  return static_cast<int>(cell_plane);
+}
+
+constexpr CellPlane
+plane_of(CellState cell) {
+  switch (cell) {
+    case CellState::EMPTY:
+      return CellPlane::EMPTY;
+    case CellState::BULB:
+      return CellPlane::BULB;
+    case CellState::MARK:
+      return CellPlane::MARK;
+    case CellState::ILLUM:
+      return CellPlane::ILLUM;
+    default:
+      return CellPlane::WALL;
+  }
+}
+
+// Every CellState is a single bit, so (one more than) its bit position fits in
+// a nibble (CellState_ORDINAL_BITS), which is how BasicBoard packs its cells.
+// Nibble 0 is not a CellState; BasicBoard uses it to mark the border.
+constexpr std::uint8_t
+to_nibble(CellState cell) {
+  return static_cast<std::uint8_t>(__builtin_ctz(+cell) + 1);
+}
+
+constexpr CellState
+from_nibble(std::uint8_t nibble) {
+  return CellState(1 << (nibble - 1));
+}
+
 namespace chr {
 constexpr char BULB  = '*';
 constexpr char ILLUM = '+';
@@ -5,6 +5,7 @@
 #include "Direction.hpp"
 #include <concepts>
 #include <cstdint>
+#include <span>
 
 namespace model {
 
@@ -80,4 +81,24 @@ concept CellVisitPredicate = requires(T visitor, CellState cell) {
                                  } -> std::same_as<bool>;
                              };
 
+// ==============
+
+// Segment visitors are given a whole run of cells at once: the coordinate of
+// its first cell, and the cells themselves in order along the row or column.
+
+template <typename T>
+concept SegmentVisitorAll =
+    requires(T visitor, std::span<CellState const> cells) {
+      { visitor(Coord{0, 0}, cells) } -> std::same_as<void>;
+    };
+
+template <typename T>
+concept SegmentVisitorSome =
+    requires(T visitor, std::span<CellState const> cells) {
+      { visitor(Coord{0, 0}, cells) } -> std::same_as<VisitStatus>;
+    };
+
+template <typename T>
+concept SegmentVisitor = SegmentVisitorAll<T> || SegmentVisitorSome<T>;
+
 } // namespace model
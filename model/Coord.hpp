@@ -14,11 +14,11 @@ namespace model {
 
 class Coord {
 public:
-  std::int8_t row_;
-  std::int8_t col_;
+  std::int16_t row_;
+  std::int16_t col_;
 
-  constexpr static int MAX_GRID_EDGE = 21;
-  constexpr static int ROW_COL_BITS  = 5;
+  constexpr static int MAX_GRID_EDGE = 255;
+  constexpr static int ROW_COL_BITS  = 8;
   static_assert((1 << ROW_COL_BITS) >= MAX_GRID_EDGE);
 
   constexpr Coord() : row_{-1}, col_{-1} {}
@@ -45,14 +45,14 @@ public:
   friend std::ostream & operator<<(std::ostream & os, Coord coord);
 
 private:
-  constexpr static std::int8_t
+  constexpr static std::int16_t
   narrow(int x) {
-    assert(x <= std::numeric_limits<std::int8_t>::max());
-    return static_cast<std::int8_t>(x);
+    assert(x <= std::numeric_limits<std::int16_t>::max());
+    return static_cast<std::int16_t>(x);
   }
 
   constexpr static int
-  widen(std::int8_t x) {
+  widen(std::int16_t x) {
     return static_cast<int>(x);
   }
 };
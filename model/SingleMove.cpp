@@ -75,10 +75,12 @@ struct std::hash<::model::SingleMove> {
     result |= ordinal(m.to_);
     result <<= CellState_ORDINAL_BITS;
 
-    result |= m.coord_.row_;
+    // mask, so negative coords (e.g. of START_GAME) don't clobber the rest
+    std::size_t constexpr coord_mask = (1 << Coord::ROW_COL_BITS) - 1;
+    result |= m.coord_.row_ & coord_mask;
     result <<= Coord::ROW_COL_BITS;
 
-    result |= m.coord_.col_;
+    result |= m.coord_.col_ & coord_mask;
     result <<= Coord::ROW_COL_BITS;
 
     static_assert((Action_ORDINAL_BITS + (2 * CellState_ORDINAL_BITS) +
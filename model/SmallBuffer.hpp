@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <type_traits>
+
+namespace model {
+
+// A runtime-sized array of trivially copyable elements, stored inline when it
+// holds up to N of them, else on the heap. Boards of the sizes that are
+// normally played fit inline, so they are copied without allocating, while
+// much larger boards remain possible.
+//
+// Only the first size() elements are copied. resize() does not preserve or
+// initialize the contents.
+template <typename T, int N>
+class SmallBuffer {
+  static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+  SmallBuffer() = default;
+  SmallBuffer(SmallBuffer const & other);
+  SmallBuffer(SmallBuffer && other) noexcept;
+  SmallBuffer & operator=(SmallBuffer const & other);
+  SmallBuffer & operator=(SmallBuffer && other) noexcept;
+
+  void resize(int size);
+  int  size() const;
+
+  T *       data();
+  T const * data() const;
+
+  T &       operator[](int idx);
+  T const & operator[](int idx) const;
+
+private:
+  // points to inline_ or to heap_
+  T *                  data_          = inline_;
+  int                  size_          = 0;
+  int                  heap_capacity_ = 0;
+  std::unique_ptr<T[]> heap_;
+  T                    inline_[N];
+};
+
+template <typename T, int N>
+SmallBuffer<T, N>::SmallBuffer(SmallBuffer const & other) {
+  resize(other.size_);
+  std::copy_n(other.data_, size_, data_);
+}
+
+template <typename T, int N>
+SmallBuffer<T, N>::SmallBuffer(SmallBuffer && other) noexcept {
+  *this = std::move(other);
+}
+
+template <typename T, int N>
+SmallBuffer<T, N> &
+SmallBuffer<T, N>::operator=(SmallBuffer const & other) {
+  if (this != &other) {
+    resize(other.size_);
+    std::copy_n(other.data_, size_, data_);
+  }
+  return *this;
+}
+
+template <typename T, int N>
+SmallBuffer<T, N> &
+SmallBuffer<T, N>::operator=(SmallBuffer && other) noexcept {
+  if (this == &other) {
+    return *this;
+  }
+  if (other.data_ == other.inline_) {
+    size_ = other.size_;
+    data_ = size_ <= N ? inline_ : heap_.get();
+    std::copy_n(other.inline_, size_, data_);
+  }
+  else {
+    heap_          = std::move(other.heap_);
+    heap_capacity_ = other.heap_capacity_;
+    size_          = other.size_;
+    data_          = heap_.get();
+
+    other.heap_capacity_ = 0;
+    other.size_          = 0;
+    other.data_          = other.inline_;
+  }
+  return *this;
+}
+
+template <typename T, int N>
+void
+SmallBuffer<T, N>::resize(int size) {
+  assert(size >= 0);
+  if (size <= N) {
+    data_ = inline_;
+  }
+  else {
+    if (size > heap_capacity_) {
+      heap_          = std::unique_ptr<T[]>(new T[size]);
+      heap_capacity_ = size;
+    }
+    data_ = heap_.get();
+  }
+  size_ = size;
+}
+
+template <typename T, int N>
+int
+SmallBuffer<T, N>::size() const {
+  return size_;
+}
+
+template <typename T, int N>
+T *
+SmallBuffer<T, N>::data() {
+  return data_;
+}
+
+template <typename T, int N>
+T const *
+SmallBuffer<T, N>::data() const {
+  return data_;
+}
+
+template <typename T, int N>
+T &
+SmallBuffer<T, N>::operator[](int idx) {
+  assert(idx >= 0 && idx < size_);
+  return data_[idx];
+}
+
+template <typename T, int N>
+T const &
+SmallBuffer<T, N>::operator[](int idx) const {
+  assert(idx >= 0 && idx < size_);
+  return data_[idx];
+}
+
+} // namespace model
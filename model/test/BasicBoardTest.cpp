@@ -3,8 +3,10 @@
 #include "CellVisitorConcepts.hpp"
 #include "Direction.hpp"
 #include <gmock/gmock-matchers.h>
+#include <algorithm>
 #include <gtest/gtest.h>
 #include <set>
+#include <span>
 
 namespace model::test {
 
@@ -237,6 +239,303 @@ TEST(BasicBoardTest, visit_empty) {
   ASSERT_EQ(34, coords.size());
 }
 
+TEST(BasicBoardTest, planes_track_cell_changes) {
+  BasicBoard b;
+  b.reset(3, 4);
+  EXPECT_EQ(12, b.count(CellPlane::EMPTY));
+  EXPECT_EQ(0, b.count(CellPlane::WALL));
+
+  b.set_cell({0, 0}, CellState::WALL2);
+  b.set_cell({0, 1}, CellState::BULB);
+  b.set_cell({0, 2}, CellState::ILLUM);
+  b.set_cell({2, 3}, CellState::MARK);
+  EXPECT_EQ(8, b.count(CellPlane::EMPTY));
+  EXPECT_EQ(1, b.count(CellPlane::WALL));
+  EXPECT_EQ(1, b.count(CellPlane::BULB));
+  EXPECT_EQ(1, b.count(CellPlane::ILLUM));
+  EXPECT_EQ(1, b.count(CellPlane::MARK));
+  EXPECT_TRUE(b.plane(CellPlane::MARK).test(11));
+
+  b.set_cell({0, 0}, CellState::WALL0);
+  b.set_cell({2, 3}, CellState::EMPTY);
+  EXPECT_EQ(9, b.count(CellPlane::EMPTY));
+  EXPECT_EQ(1, b.count(CellPlane::WALL));
+  EXPECT_TRUE(b.plane(CellPlane::MARK).none());
+
+  b.reset(2, 2);
+  EXPECT_EQ(4, b.count(CellPlane::EMPTY));
+  EXPECT_TRUE(b.plane(CellPlane::BULB).none());
+}
+
+TEST(BasicBoardTest, visit_plane) {
+  BasicBoard board;
+  {
+    ASCIILevelCreator creator;
+    creator("X.*");
+    creator("1*3");
+    creator("0X4");
+    creator.finished(&board);
+  }
+
+  Moves moves;
+  board.visit_plane(board.plane(CellPlane::BULB) | board.plane(CellPlane::MARK),
+                    recorder(moves));
+  EXPECT_EQ((Moves{mk_move({0, 0}, CellState::MARK),
+                   mk_move({0, 2}, CellState::BULB),
+                   mk_move({1, 1}, CellState::BULB),
+                   mk_move({2, 1}, CellState::MARK)}),
+            moves);
+}
+
+TEST(BasicBoardTest, copy_packed_cells) {
+  BasicBoard big(12, 12);
+  big.set_cell({11, 11}, CellState::WALL3);
+
+  // 3x3 has an odd number of cells, so the last byte is half used
+  BasicBoard board;
+  {
+    ASCIILevelCreator creator;
+    creator("X.*");
+    creator("1+3");
+    creator("0X4");
+    creator.finished(&board);
+  }
+
+  big = board;
+  EXPECT_EQ(board, big);
+  EXPECT_EQ(3, big.height());
+  EXPECT_EQ(CellState::BULB, big.get_cell({0, 2}));
+  EXPECT_EQ(CellState::ILLUM, big.get_cell({1, 1}));
+  EXPECT_EQ(CellState::WALL4, big.get_cell({2, 2}));
+  EXPECT_EQ(4, big.count(CellPlane::WALL));
+
+  BasicBoard copy(big);
+  copy.set_cell({2, 2}, CellState::WALL0);
+  EXPECT_NE(big, copy);
+  EXPECT_EQ(CellState::WALL4, big.get_cell({2, 2}));
+  EXPECT_EQ(CellState::MARK, copy.get_cell({2, 1}));
+}
+
+TEST(BasicBoardTest, hash) {
+  BasicBoard board1(3, 4);
+  BasicBoard board2(3, 4);
+  EXPECT_EQ(board1.hash(), board2.hash());
+  EXPECT_NE(board1.hash(), BasicBoard(4, 3).hash());
+
+  auto const empty_hash = board1.hash();
+  board1.set_cell({1, 2}, CellState::WALL2);
+  board1.set_cell({0, 0}, CellState::BULB);
+  EXPECT_NE(empty_hash, board1.hash());
+
+  // order of changes doesn't matter, only the resulting cells
+  board2.set_cell({0, 0}, CellState::MARK);
+  board2.set_cell({0, 0}, CellState::BULB);
+  board2.set_cell({1, 2}, CellState::WALL2);
+  EXPECT_EQ(board1, board2);
+  EXPECT_EQ(board1.hash(), board2.hash());
+  EXPECT_EQ(std::hash<BasicBoard>{}(board1), std::hash<BasicBoard>{}(board2));
+
+  BasicBoard copy = board1;
+  EXPECT_EQ(board1.hash(), copy.hash());
+
+  // undoing the changes restores the hash
+  board1.set_cell({1, 2}, CellState::EMPTY);
+  board1.set_cell({0, 0}, CellState::EMPTY);
+  EXPECT_EQ(empty_hash, board1.hash());
+}
+
+TEST(BasicBoardTest, ordering) {
+  BasicBoard empty(3, 3);
+  BasicBoard bulb_first(3, 3);
+  bulb_first.set_cell({0, 0}, CellState::BULB);
+  BasicBoard bulb_last(3, 3);
+  bulb_last.set_cell({2, 2}, CellState::BULB);
+  BasicBoard wall_last(3, 3);
+  wall_last.set_cell({2, 2}, CellState::WALL1);
+
+  // row-major, comparing CellState values
+  EXPECT_LT(wall_last, empty);
+  EXPECT_LT(empty, bulb_last);
+  EXPECT_LT(bulb_last, bulb_first);
+  EXPECT_GT(bulb_first, wall_last);
+
+  // narrower boards first
+  EXPECT_LT(BasicBoard(9, 2), empty);
+
+  // equal boards compare equal, even when reached differently
+  BasicBoard copy(3, 3);
+  copy.set_cell({0, 0}, CellState::MARK);
+  copy.set_cell({0, 0}, CellState::BULB);
+  EXPECT_EQ(std::strong_ordering::equal, bulb_first <=> copy);
+
+  std::set<BasicBoard> boards{bulb_first, empty, bulb_last, copy, wall_last};
+  EXPECT_EQ(4, boards.size());
+}
+
+TEST(BasicBoardTest, diff) {
+  // big enough for the cells to span more than one 32 byte chunk
+  BasicBoard from(10, 10);
+  BasicBoard to = from;
+  EXPECT_TRUE(model::diff(from, to).empty());
+
+  from.set_cell({0, 1}, CellState::MARK);
+  from.set_cell({9, 9}, CellState::BULB);
+  to.set_cell({0, 0}, CellState::WALL2);
+  to.set_cell({0, 1}, CellState::BULB);
+  to.set_cell({5, 4}, CellState::ILLUM);
+  to.set_cell({5, 5}, CellState::ILLUM);
+
+  using enum Action;
+  using enum CellState;
+  auto moves = model::diff(from, to);
+  EXPECT_EQ((Moves{{ADD, EMPTY, WALL2, {0, 0}},
+                   {ADD, MARK, BULB, {0, 1}},
+                   {ADD, EMPTY, ILLUM, {5, 4}},
+                   {ADD, EMPTY, ILLUM, {5, 5}},
+                   {REMOVE, BULB, EMPTY, {9, 9}}}),
+            moves);
+
+  for (auto const & move : moves) {
+    from.set_cell(move.coord_, move.to_);
+  }
+  EXPECT_EQ(to, from);
+
+  EXPECT_THROW(model::diff(from, BasicBoard(10, 9)), std::runtime_error);
+}
+
+TEST(BasicBoardTest, large_board) {
+  BasicBoard board(200, 210);
+  EXPECT_EQ(200, board.height());
+  EXPECT_EQ(210, board.width());
+  EXPECT_EQ(200 * 210, board.count(CellPlane::EMPTY));
+
+  board.set_cell({199, 209}, CellState::BULB);
+  board.set_cell({199, 100}, CellState::WALL1);
+  board.set_cell({0, 0}, CellState::MARK);
+  EXPECT_EQ(CellState::BULB, board.get_cell({199, 209}));
+  EXPECT_EQ(std::nullopt, board.get_opt_cell({200, 0}));
+
+  int count = 0;
+  board.visit_row_left_of({199, 209}, [&](Coord, CellState) { ++count; });
+  EXPECT_EQ(109, count); // 108 empties, then the wall
+
+  BasicBoard copy = board;
+  EXPECT_EQ(board, copy);
+  EXPECT_EQ(board.hash(), copy.hash());
+  copy.set_cell({0, 0}, CellState::EMPTY);
+  EXPECT_EQ(
+      (Moves{{Action::REMOVE, CellState::MARK, CellState::EMPTY, {0, 0}}}),
+      model::diff(board, copy));
+
+  // shrinking a board back to an ordinary size works too
+  copy = BasicBoard(3, 3);
+  EXPECT_EQ(9, copy.count(CellPlane::EMPTY));
+
+  EXPECT_THROW(BasicBoard(Coord::MAX_GRID_EDGE + 1, 3), std::runtime_error);
+}
+
+TEST(BasicBoardTest, col_major_mirror) {
+  BasicBoard        plain;
+  ASCIILevelCreator creator;
+  creator("..*..1");
+  creator("12.00.");
+  creator("...X+.");
+  creator("...X*.");
+  creator.finished(&plain);
+
+  BasicBoard mirrored = plain;
+  EXPECT_FALSE(mirrored.has_col_major_mirror());
+  mirrored.set_col_major_mirror(true);
+  EXPECT_TRUE(mirrored.has_col_major_mirror());
+
+  // changes after enabling it are mirrored too
+  for (auto * board : {&plain, &mirrored}) {
+    board->set_cell({3, 5}, CellState::WALL2);
+    board->set_cell({0, 1}, CellState::MARK);
+  }
+  EXPECT_EQ(plain, mirrored);
+
+  auto expect_same_col_visits = [](BasicBoard const & expected,
+                                   BasicBoard const & actual) {
+    expected.visit_board([&](Coord coord, CellState) {
+      DirectionMoves expected_moves, actual_moves;
+      expected.visit_col_above(coord, recorder(expected_moves));
+      expected.visit_col_below(coord, recorder(expected_moves));
+      actual.visit_col_above(coord, recorder(actual_moves));
+      actual.visit_col_below(coord, recorder(actual_moves));
+      EXPECT_EQ(expected_moves, actual_moves) << coord;
+    });
+  };
+  expect_same_col_visits(plain, mirrored);
+
+  BasicBoard copy = mirrored;
+  EXPECT_TRUE(copy.has_col_major_mirror());
+  expect_same_col_visits(plain, copy);
+
+  // stays enabled across reset
+  copy.reset(4, 2);
+  plain.reset(4, 2);
+  copy.set_cell({3, 1}, CellState::WALL0);
+  plain.set_cell({3, 1}, CellState::WALL0);
+  EXPECT_TRUE(copy.has_col_major_mirror());
+  expect_same_col_visits(plain, copy);
+
+  copy.set_col_major_mirror(false);
+  EXPECT_FALSE(copy.has_col_major_mirror());
+  expect_same_col_visits(plain, copy);
+}
+
+TEST(BasicBoardTest, visit_segments) {
+  BasicBoard        board;
+  ASCIILevelCreator creator;
+  creator("..*.0");
+  creator("12X..");
+  creator("..+.2");
+  creator.finished(&board);
+
+  using Segments = std::vector<std::pair<Coord, std::vector<CellState>>>;
+  auto recorder  = [](Segments & segments) {
+    return [&](Coord start, std::span<CellState const> cells) {
+      segments.emplace_back(start,
+                            std::vector<CellState>(cells.begin(), cells.end()));
+    };
+  };
+
+  using enum CellState;
+  Segments rows;
+  board.visit_row_segments(recorder(rows));
+  EXPECT_EQ((Segments{{{0, 0}, {EMPTY, EMPTY, BULB, EMPTY}},
+                      {{1, 2}, {MARK, EMPTY, EMPTY}},
+                      {{2, 0}, {EMPTY, EMPTY, ILLUM, EMPTY}}}),
+            rows);
+
+  Segments const expected_cols{{{0, 0}, {EMPTY}},
+                               {{2, 0}, {EMPTY}},
+                               {{0, 1}, {EMPTY}},
+                               {{2, 1}, {EMPTY}},
+                               {{0, 2}, {BULB, MARK, ILLUM}},
+                               {{0, 3}, {EMPTY, EMPTY, EMPTY}},
+                               {{1, 4}, {EMPTY}}};
+  Segments cols;
+  board.visit_col_segments(recorder(cols));
+  EXPECT_EQ(expected_cols, cols);
+
+  board.set_col_major_mirror(true);
+  cols.clear();
+  board.visit_col_segments(recorder(cols));
+  EXPECT_EQ(expected_cols, cols);
+
+  // stops early
+  int  count = 0;
+  bool completed =
+      board.visit_row_segments([&](Coord, std::span<CellState const> cells) {
+        ++count;
+        return std::ranges::count(cells, MARK) ? STOP_VISITING : KEEP_VISITING;
+      });
+  EXPECT_FALSE(completed);
+  EXPECT_EQ(2, count);
+}
+
 TEST(BasicBoardTest, visit_some) {
   BasicBoard board;
   {
@@ -0,0 +1,97 @@
+#include "BitPlane.hpp"
+#include <gmock/gmock-matchers.h>
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace model::test {
+
+using namespace ::testing;
+
+TEST(BitPlaneTest, set_reset_test) {
+  BitPlane plane(BitPlane::MAX_BITS);
+  EXPECT_TRUE(plane.none());
+  EXPECT_EQ(0, plane.count());
+
+  plane.set(0);
+  plane.set(63);
+  plane.set(64);
+  plane.set(BitPlane::MAX_BITS - 1);
+  EXPECT_TRUE(plane.any());
+  EXPECT_EQ(4, plane.count());
+  EXPECT_TRUE(plane.test(63));
+  EXPECT_TRUE(plane.test(64));
+  EXPECT_FALSE(plane.test(65));
+
+  plane.reset(63);
+  EXPECT_FALSE(plane.test(63));
+  EXPECT_EQ(3, plane.count());
+
+  plane.clear();
+  EXPECT_TRUE(plane.none());
+}
+
+TEST(BitPlaneTest, set_all) {
+  BitPlane plane(BitPlane::MAX_BITS);
+  plane.set(200);
+  plane.resize(70);
+  EXPECT_TRUE(plane.none());
+
+  plane.set_all();
+  EXPECT_EQ(70, plane.count());
+  EXPECT_TRUE(plane.test(69));
+}
+
+TEST(BitPlaneTest, copy_only_uses_size) {
+  BitPlane big(BitPlane::MAX_BITS);
+  big.set(300);
+
+  BitPlane small(10);
+  small.set(3);
+  big = small;
+  EXPECT_EQ(10, big.size());
+  EXPECT_EQ(1, big.count());
+  EXPECT_TRUE(big.test(3));
+  EXPECT_EQ(small, big);
+
+  // growing again must not resurrect stale bits from before the copy
+  big.resize(BitPlane::MAX_BITS);
+  EXPECT_TRUE(big.none());
+}
+
+TEST(BitPlaneTest, combine) {
+  BitPlane a(BitPlane::MAX_BITS), b(BitPlane::MAX_BITS);
+  a.set(1);
+  a.set(100);
+  b.set(100);
+  b.set(300);
+
+  EXPECT_EQ(3, (a | b).count());
+  EXPECT_EQ(1, (a & b).count());
+  EXPECT_TRUE((a & b).test(100));
+  EXPECT_EQ(1, a.count_common(b));
+
+  BitPlane const diff = a ^ b;
+  EXPECT_EQ(2, diff.count());
+  EXPECT_TRUE(diff.test(1));
+  EXPECT_TRUE(diff.test(300));
+}
+
+TEST(BitPlaneTest, visit_set_bits_in_order) {
+  BitPlane plane(BitPlane::MAX_BITS);
+  for (int idx : {300, 5, 64, 127, 0}) {
+    plane.set(idx);
+  }
+
+  std::vector<int> visited;
+  EXPECT_TRUE(plane.visit_set_bits([&](int idx) { visited.push_back(idx); }));
+  EXPECT_THAT(visited, ElementsAre(0, 5, 64, 127, 300));
+
+  visited.clear();
+  EXPECT_FALSE(plane.visit_set_bits([&](int idx) {
+    visited.push_back(idx);
+    return idx < 64 ? KEEP_VISITING : STOP_VISITING;
+  }));
+  EXPECT_THAT(visited, ElementsAre(0, 5, 64));
+}
+
+} // namespace model::test
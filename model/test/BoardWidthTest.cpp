@@ -0,0 +1,35 @@
+#include "BoardWidth.hpp"
+#include <gtest/gtest.h>
+#include <type_traits>
+
+namespace model::test {
+
+template <typename WidthT>
+constexpr bool is_fixed = not std::is_same_v<WidthT, DynamicWidth>;
+
+TEST(BoardWidthTest, dispatch) {
+  for (int width : {6, 8, 10, 15, 20}) {
+    bool fixed = with_board_width(width, [&](auto w) {
+      EXPECT_EQ(width, w.value());
+      return is_fixed<decltype(w)>;
+    });
+    EXPECT_TRUE(fixed) << width;
+  }
+
+  for (int width : {1, 7, 12, 21}) {
+    bool fixed = with_board_width(width, [&](auto w) {
+      EXPECT_EQ(width, w.value());
+      return is_fixed<decltype(w)>;
+    });
+    EXPECT_FALSE(fixed) << width;
+  }
+}
+
+TEST(BoardWidthTest, flat_index_conversions) {
+  EXPECT_EQ(Coord(2, 3), coord_of(23, FixedWidth<10>{}));
+  EXPECT_EQ(Coord(3, 2), coord_of(23, DynamicWidth{7}));
+  EXPECT_EQ(23, flat_idx_of(Coord(2, 3), FixedWidth<10>{}));
+  EXPECT_EQ(23, flat_idx_of(Coord(3, 2), DynamicWidth{7}));
+}
+
+} // namespace model::test
@@ -0,0 +1,31 @@
+#include "ByteCompare.hpp"
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace model::test {
+
+TEST(ByteCompareTest, first_mismatch) {
+  // long enough to use every chunk size, with a ragged tail
+  std::vector<std::uint8_t> lhs(75), rhs(75);
+  for (int i = 0; i < 75; ++i) {
+    lhs[i] = rhs[i] = static_cast<std::uint8_t>(i * 7);
+  }
+  EXPECT_EQ(75, first_mismatch(lhs.data(), rhs.data(), 75));
+  EXPECT_EQ(0, first_mismatch(lhs.data(), rhs.data(), 0));
+
+  for (int i : {0, 7, 8, 15, 16, 31, 32, 47, 63, 64, 74}) {
+    rhs[i] ^= 0x10;
+    EXPECT_EQ(i, first_mismatch(lhs.data(), rhs.data(), 75)) << i;
+
+    // only the first difference is reported
+    rhs[74] ^= 0x01;
+    EXPECT_EQ(i, first_mismatch(lhs.data(), rhs.data(), 75)) << i;
+    rhs[74] ^= 0x01;
+
+    // and differences past the size are ignored
+    EXPECT_EQ(i, first_mismatch(lhs.data(), rhs.data(), i));
+    rhs[i] ^= 0x10;
+  }
+}
+
+} // namespace model::test
@@ -0,0 +1,57 @@
+#include "SmallBuffer.hpp"
+#include <gtest/gtest.h>
+#include <numeric>
+#include <utility>
+
+namespace model::test {
+
+using Buffer = SmallBuffer<int, 4>;
+
+Buffer
+make_buffer(int size) {
+  Buffer buffer;
+  buffer.resize(size);
+  std::iota(buffer.data(), buffer.data() + size, 100);
+  return buffer;
+}
+
+TEST(SmallBufferTest, inline_and_heap_copies) {
+  for (int size : {0, 3, 4, 5, 50}) {
+    Buffer original = make_buffer(size);
+    Buffer copy(original);
+    ASSERT_EQ(size, copy.size());
+    EXPECT_NE(original.data(), copy.data());
+    for (int i = 0; i < size; ++i) {
+      EXPECT_EQ(100 + i, copy[i]);
+    }
+  }
+}
+
+TEST(SmallBufferTest, assign_between_sizes) {
+  Buffer big   = make_buffer(50);
+  Buffer small = make_buffer(2);
+
+  big = small;
+  ASSERT_EQ(2, big.size());
+  EXPECT_EQ(101, big[1]);
+
+  small = make_buffer(20);
+  ASSERT_EQ(20, small.size());
+  EXPECT_EQ(119, small[19]);
+}
+
+TEST(SmallBufferTest, move) {
+  Buffer       heap      = make_buffer(50);
+  int const *  heap_data = heap.data();
+  Buffer const moved(std::move(heap));
+  EXPECT_EQ(heap_data, moved.data());
+  EXPECT_EQ(149, moved[49]);
+  EXPECT_EQ(0, heap.size());
+
+  Buffer inline_buffer = make_buffer(3);
+  Buffer moved_inline(std::move(inline_buffer));
+  ASSERT_EQ(3, moved_inline.size());
+  EXPECT_EQ(102, moved_inline[2]);
+}
+
+} // namespace model::test
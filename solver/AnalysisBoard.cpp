@@ -7,25 +7,23 @@
 
 namespace solver {
 
-AnalysisBoard::AnalysisBoard(model::BasicBoard const & current) {
-  position_boards_.reserve(4);
-  position_boards_.push_back(current);
-}
+AnalysisBoard::AnalysisBoard(model::BasicBoard const & current)
+    : position_board_(current) {}
 
 PositionBoard &
 AnalysisBoard::cur() {
-  return position_boards_.back();
+  return position_board_;
 }
 
 PositionBoard const &
 AnalysisBoard::cur() const {
-  return position_boards_.back();
+  return position_board_;
 }
 
 void
 AnalysisBoard::clone_position() {
   if (visit_depth_ == 0) {
-    position_boards_.push_back(position_boards_.back());
+    position_board_.checkpoint();
   }
   else {
     throw std::runtime_error(
@@ -35,11 +33,11 @@ AnalysisBoard::clone_position() {
 
 void
 AnalysisBoard::pop() {
-  if (position_boards_.size() == 1) {
+  if (position_board_.num_checkpoints() == 0) {
     return;
   }
   if (visit_depth_ == 0) {
-    position_boards_.pop_back();
+    position_board_.rollback();
   }
   else {
     throw std::runtime_error(
@@ -49,7 +47,7 @@ AnalysisBoard::pop() {
 
 std::ostream &
 operator<<(std::ostream & os, AnalysisBoard const & aboard) {
-  os << "AnalysisBoard{Depth=" << aboard.position_boards_.size() << ", "
+  os << "AnalysisBoard{Depth=" << aboard.stack_size() << ", "
      << aboard.cur() << "}";
   return os;
 }
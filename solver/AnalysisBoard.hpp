@@ -12,14 +12,16 @@
 namespace solver {
 
 // Essentially, a stack of PositionBoard, with the PositionBoard interface
-// reflecting the top object
+// reflecting the top object. The stack is a single PositionBoard with
+// checkpoints, so cloning a position doesn't copy it, and popping it undoes
+// only the changes made since.
 class AnalysisBoard {
 public:
   AnalysisBoard(model::BasicBoard const & current);
 
   AnalysisBoard &
   operator=(solver::PositionBoard const & pboard) {
-    cur() = pboard;
+    cur().set_position(pboard);
     return *this;
   }
 
@@ -29,7 +31,7 @@ public:
 
   void
   reset(model::BasicBoard const & board) {
-    cur().reset(board);
+    cur().set_position(PositionBoard(board));
   }
 
   void
@@ -39,14 +41,14 @@ public:
     cur().reevaluate_board_state(policy);
   }
 
-  auto
+  std::size_t
   stack_size() const {
-    return position_boards_.size();
+    return cur().num_checkpoints() + 1;
   }
 
   void
   reset(solver::PositionBoard const & board) {
-    cur().reset(board.board());
+    reset(board.board());
   }
 
   int
@@ -254,8 +256,8 @@ private:
   model::BasicBoard &   mut_board();
 
 private:
-  mutable int                visit_depth_ = 0;
-  std::vector<PositionBoard> position_boards_;
+  mutable int   visit_depth_ = 0;
+  PositionBoard position_board_;
 };
 
 } // namespace solver
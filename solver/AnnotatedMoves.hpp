@@ -0,0 +1,174 @@
+#pragma once
+
+#include "AnnotatedMove.hpp"
+#include "BitPlane.hpp"
+#include "Coord.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace solver {
+
+// The moves found by the trivial-move rules, at most one per cell. Several
+// rules can find the same cell, so each move is only added if its cell has no
+// move yet, which a plane of the cells with moves answers without searching
+// the moves. Otherwise it reads like a vector of the moves, in the order they
+// were added.
+//
+// The plane covers the board the moves are for, if sized for it, else it
+// grows to fit the cells moved to.
+class AnnotatedMoves {
+public:
+  // (like a set's, the moves can't be changed in place, as that could take
+  // them out of step with the cells)
+  using value_type     = AnnotatedMove;
+  using const_iterator = std::vector<AnnotatedMove>::const_iterator;
+  using iterator       = const_iterator;
+
+  AnnotatedMoves() = default;
+  AnnotatedMoves(int height, int width);
+
+  // sizes the plane for a board of the given size, keeping the moves (which
+  // must be on it)
+  void reserve_for(int height, int width);
+
+  // Adds move unless its cell already has a move, returning whether it did.
+  bool insert_if_unique(AnnotatedMove const & move);
+  bool has_move_at(model::Coord) const;
+
+  void        clear();
+  void        reserve(std::size_t size);
+  std::size_t size() const;
+  bool        empty() const;
+
+  AnnotatedMove const & operator[](std::size_t idx) const;
+  AnnotatedMove const & front() const;
+  AnnotatedMove const & back() const;
+
+  const_iterator begin() const;
+  const_iterator end() const;
+
+  friend bool
+  operator==(AnnotatedMoves const & lhs, AnnotatedMoves const & rhs) {
+    return lhs.moves_ == rhs.moves_;
+  }
+
+private:
+  bool covers(model::Coord) const;
+  int  bit_of(model::Coord) const;
+
+  std::vector<AnnotatedMove> moves_;
+
+  // the cells of moves_, by flat index on a height_ x width_ board
+  int             height_ = 0;
+  int             width_  = 0;
+  model::BitPlane has_move_;
+};
+
+inline AnnotatedMoves::AnnotatedMoves(int height, int width) {
+  reserve_for(height, width);
+}
+
+inline void
+AnnotatedMoves::reserve_for(int height, int width) {
+  assert(height >= 0 && height <= model::Coord::MAX_GRID_EDGE);
+  assert(width >= 0 && width <= model::Coord::MAX_GRID_EDGE);
+  if (height == height_ && width == width_) {
+    return;
+  }
+  height_ = height;
+  width_  = width;
+  has_move_.resize(height * width);
+  for (AnnotatedMove const & move : moves_) {
+    has_move_.set(bit_of(move.next_move.coord_));
+  }
+}
+
+inline bool
+AnnotatedMoves::covers(model::Coord coord) const {
+  return coord.row_ >= 0 && coord.row_ < height_ && coord.col_ >= 0 &&
+         coord.col_ < width_;
+}
+
+inline int
+AnnotatedMoves::bit_of(model::Coord coord) const {
+  assert(covers(coord));
+  return coord.row_ * width_ + coord.col_;
+}
+
+inline bool
+AnnotatedMoves::insert_if_unique(AnnotatedMove const & move) {
+  model::Coord const coord = move.next_move.coord_;
+  assert(coord.row_ >= 0 && coord.row_ < model::Coord::MAX_GRID_EDGE &&
+         coord.col_ >= 0 && coord.col_ < model::Coord::MAX_GRID_EDGE);
+  if (not covers(coord)) {
+    // doubled, so that moves added without sizing first rarely regrow it
+    int constexpr max_edge = model::Coord::MAX_GRID_EDGE;
+    reserve_for(std::min(max_edge, std::max(2 * height_, coord.row_ + 1)),
+                std::min(max_edge, std::max(2 * width_, coord.col_ + 1)));
+  }
+  int const bit = bit_of(coord);
+  if (has_move_.test(bit)) {
+    return false;
+  }
+  has_move_.set(bit);
+  moves_.push_back(move);
+  return true;
+}
+
+inline bool
+AnnotatedMoves::has_move_at(model::Coord coord) const {
+  return covers(coord) && has_move_.test(bit_of(coord));
+}
+
+inline void
+AnnotatedMoves::clear() {
+  // only the bits of the moves are set, so there's no need to clear them all
+  for (AnnotatedMove const & move : moves_) {
+    has_move_.reset(bit_of(move.next_move.coord_));
+  }
+  moves_.clear();
+}
+
+inline void
+AnnotatedMoves::reserve(std::size_t size) {
+  moves_.reserve(size);
+}
+
+inline std::size_t
+AnnotatedMoves::size() const {
+  return moves_.size();
+}
+
+inline bool
+AnnotatedMoves::empty() const {
+  return moves_.empty();
+}
+
+inline AnnotatedMove const &
+AnnotatedMoves::operator[](std::size_t idx) const {
+  return moves_[idx];
+}
+
+inline AnnotatedMove const &
+AnnotatedMoves::front() const {
+  return moves_.front();
+}
+
+inline AnnotatedMove const &
+AnnotatedMoves::back() const {
+  return moves_.back();
+}
+
+inline AnnotatedMoves::const_iterator
+AnnotatedMoves::begin() const {
+  return moves_.begin();
+}
+
+inline AnnotatedMoves::const_iterator
+AnnotatedMoves::end() const {
+  return moves_.end();
+}
+
+} // namespace solver
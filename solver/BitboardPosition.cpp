@@ -0,0 +1,327 @@
+#include "BitboardPosition.hpp"
+#include "BasicBoard.hpp"
+#include "BitPlane.hpp"
+#include "CellState.hpp"
+#include "Coord.hpp"
+#include "DecisionType.hpp"
+#include "SegmentIndex.hpp"
+
+namespace solver {
+
+using model::BitPlane;
+using model::CellPlane;
+using model::CellState;
+using model::Coord;
+
+// A segment's cells are visited in increasing flat index, so each word is
+// started once.
+BitboardPosition::SegmentMasks::SegmentMasks(
+    std::vector<Segment> const & segments, int width, int idx_step) {
+  starts.reserve(segments.size() + 1);
+  for (Segment const & segment : segments) {
+    starts.push_back(static_cast<int>(words.size()));
+    int const first = segment.start.row_ * width + segment.start.col_;
+    for (int i = 0; i < segment.length; ++i) {
+      int const idx      = first + i * idx_step;
+      int const word_idx = idx / BitPlane::WORD_BITS;
+      if (words.size() == static_cast<std::size_t>(starts.back()) ||
+          words.back().word_idx != word_idx) {
+        words.push_back({word_idx, 0});
+      }
+      words.back().bits |= BitPlane::Word{1} << (idx % BitPlane::WORD_BITS);
+    }
+  }
+  starts.push_back(static_cast<int>(words.size()));
+}
+
+BitboardPosition::Layout::Layout(model::BasicBoard const & board)
+    : segments{board}
+    , row_masks{segments.row_segments, board.width(), 1}
+    , col_masks{segments.col_segments, board.width(), board.width()} {}
+
+void
+BitboardPosition::add_mask(BitPlane & plane, Mask mask) {
+  for (auto const & [word_idx, bits] : mask) {
+    plane.set_bits(word_idx, bits);
+  }
+}
+
+int
+BitboardPosition::count_common(Mask mask, BitPlane const & plane) {
+  int total = 0;
+  for (auto const & [word_idx, bits] : mask) {
+    total += __builtin_popcountll(plane.word(word_idx) & bits);
+  }
+  return total;
+}
+
+BitboardPosition::BitboardPosition(model::BasicBoard const & board) {
+  reset(board);
+}
+
+void
+BitboardPosition::reset(model::BasicBoard const & board) {
+  // Walls are fixed while playing, so the masks can usually be kept.
+  if (not layout_ ||
+      layout_->segments.walls != board.plane(CellPlane::WALL)) {
+    layout_ = std::make_shared<Layout const>(board);
+  }
+  board_ = board;
+
+  // the board's own light is recast from its bulbs
+  BitPlane const was_lit = board_.plane(CellPlane::ILLUM);
+  board_.visit_plane(was_lit, [&](Coord coord, CellState) {
+    board_.set_cell(coord, CellState::EMPTY);
+  });
+
+  num_crowded_segments_ = 0;
+  BitPlane const & bulbs = board_.plane(CellPlane::BULB);
+  for (auto const * masks : {&layout_->row_masks, &layout_->col_masks}) {
+    int const num_segments = static_cast<int>(masks->starts.size()) - 1;
+    for (int segment = 0; segment < num_segments; ++segment) {
+      num_crowded_segments_ += count_common(masks->mask(segment), bulbs) > 1;
+    }
+  }
+  relight();
+  board_.visit_plane(lit_, [&](Coord coord, CellState cell) {
+    if (is_illuminable(cell)) {
+      board_.set_cell(coord, CellState::ILLUM);
+    }
+  });
+
+  int const num_cells = height() * width();
+  unsatisfied_walls_.resize(num_cells);
+  broken_walls_.resize(num_cells);
+  board_.visit_plane(board_.plane(CellPlane::WALL),
+                     [&](Coord coord, CellState cell) {
+                       check_wall(coord, cell);
+                     });
+}
+
+void
+BitboardPosition::relight() {
+  lit_.resize(height() * width());
+  board_.plane(CellPlane::BULB).visit_set_bits([&](int idx) {
+    add_mask(lit_, row_mask(idx));
+    add_mask(lit_, col_mask(idx));
+  });
+}
+
+bool
+BitboardPosition::add_bulb(Coord coord) {
+  CellState const cell = get_cell(coord);
+  if (cell != (cell & (CellState::EMPTY | CellState::ILLUM))) {
+    return false;
+  }
+  int const idx = flat_idx(coord);
+  board_.set_cell(coord, CellState::BULB);
+
+  BitPlane const & bulbs = board_.plane(CellPlane::BULB);
+  num_crowded_segments_ += count_common(row_mask(idx), bulbs) == 2;
+  num_crowded_segments_ += count_common(col_mask(idx), bulbs) == 2;
+
+  BitPlane const was_lit = lit_;
+  add_mask(lit_, row_mask(idx));
+  add_mask(lit_, col_mask(idx));
+  update_cells(was_lit, idx);
+  return true;
+}
+
+bool
+BitboardPosition::remove_bulb(Coord coord) {
+  if (not is_bulb(get_cell(coord))) {
+    return false;
+  }
+  int const        idx   = flat_idx(coord);
+  BitPlane const & bulbs = board_.plane(CellPlane::BULB);
+  num_crowded_segments_ -= count_common(row_mask(idx), bulbs) == 2;
+  num_crowded_segments_ -= count_common(col_mask(idx), bulbs) == 2;
+  board_.set_cell(coord, CellState::EMPTY);
+
+  // Light can't be subtracted from an OR, so is recomputed from the bulbs
+  // that are left.
+  BitPlane const was_lit = lit_;
+  relight();
+  if (lit_.test(idx)) {
+    board_.set_cell(coord, CellState::ILLUM);
+  }
+  update_cells(was_lit, idx);
+  return true;
+}
+
+bool
+BitboardPosition::add_mark(Coord coord) {
+  if (not is_empty(get_cell(coord))) {
+    return false;
+  }
+  board_.set_cell(coord, CellState::MARK);
+  update_cells(lit_, flat_idx(coord));
+  return true;
+}
+
+bool
+BitboardPosition::remove_mark(Coord coord) {
+  if (not is_mark(get_cell(coord))) {
+    return false;
+  }
+  board_.set_cell(coord, CellState::EMPTY);
+  update_cells(lit_, flat_idx(coord));
+  return true;
+}
+
+bool
+BitboardPosition::apply_move(model::SingleMove const & move) {
+  if (move.action_ == model::Action::ADD) {
+    if (move.to_ == CellState::BULB) {
+      add_bulb(move.coord_);
+      return true;
+    }
+    if (move.to_ == CellState::MARK) {
+      add_mark(move.coord_);
+      return true;
+    }
+  }
+  else if (move.action_ == model::Action::REMOVE) {
+    if (move.from_ == CellState::BULB) {
+      remove_bulb(move.coord_);
+      return true;
+    }
+    if (move.from_ == CellState::MARK) {
+      remove_mark(move.coord_);
+      return true;
+    }
+  }
+  return false;
+}
+
+void
+BitboardPosition::update_cells(BitPlane const & was_lit, int played_idx) {
+  BitPlane changed = lit_ ^ was_lit;
+  board_.visit_plane(changed, [&](Coord coord, CellState cell) {
+    if (lit_.test(flat_idx(coord))) {
+      if (is_illuminable(cell)) {
+        board_.set_cell(coord, CellState::ILLUM);
+      }
+    }
+    else if (cell == CellState::ILLUM) {
+      board_.set_cell(coord, CellState::EMPTY);
+    }
+  });
+  changed.set(played_idx);
+  check_walls_near(changed);
+}
+
+void
+BitboardPosition::check_walls_near(BitPlane const & changed) {
+  board_.visit_plane(changed, [&](Coord coord, CellState) {
+    board_.visit_adjacent(coord, [&](Coord adj_coord, CellState adj_cell) {
+      if (is_wall_with_deps(adj_cell)) {
+        check_wall(adj_coord, adj_cell);
+      }
+    });
+  });
+}
+
+void
+BitboardPosition::check_wall(Coord wall_coord, CellState wall_cell) {
+  int const deps = model::num_wall_deps(wall_cell);
+  if (deps == 0) {
+    return;
+  }
+  int bulb_neighbors  = 0;
+  int empty_neighbors = 0;
+  board_.visit_adjacent(wall_coord, [&](Coord, CellState cell) {
+    bulb_neighbors += is_bulb(cell);
+    empty_neighbors += is_empty(cell);
+  });
+
+  int const idx = flat_idx(wall_coord);
+  if (bulb_neighbors < deps) {
+    unsatisfied_walls_.set(idx);
+  }
+  else {
+    unsatisfied_walls_.reset(idx);
+  }
+  if (bulb_neighbors > deps || deps - bulb_neighbors > empty_neighbors) {
+    broken_walls_.set(idx);
+  }
+  else {
+    broken_walls_.reset(idx);
+  }
+}
+
+bool
+BitboardPosition::has_error() const {
+  return num_crowded_segments_ > 0 || broken_walls_.any();
+}
+
+DecisionType
+BitboardPosition::decision_type() const {
+  if (broken_walls_.any()) {
+    Coord const wall_coord     = *get_ref_location();
+    int         bulb_neighbors = 0;
+    board_.visit_adjacent(wall_coord, [&](Coord, CellState cell) {
+      bulb_neighbors += is_bulb(cell);
+    });
+    return bulb_neighbors > model::num_wall_deps(get_cell(wall_coord))
+               ? DecisionType::WALL_HAS_TOO_MANY_BULBS
+               : DecisionType::WALL_CANNOT_BE_SATISFIED;
+  }
+  return num_crowded_segments_ > 0 ? DecisionType::BULBS_SEE_EACH_OTHER
+                                   : DecisionType::NONE;
+}
+
+model::OptCoord
+BitboardPosition::get_ref_location() const {
+  model::OptCoord location;
+  auto const      first = [&](Coord coord, CellState) {
+    location = coord;
+    return model::STOP_VISITING;
+  };
+  if (broken_walls_.any()) {
+    board_.visit_plane(broken_walls_, first);
+  }
+  else if (num_crowded_segments_ > 0) {
+    BitPlane const & bulbs = board_.plane(CellPlane::BULB);
+    board_.visit_plane(bulbs, [&](Coord coord, CellState cell) {
+      int const idx = flat_idx(coord);
+      return count_common(row_mask(idx), bulbs) > 1 ||
+                     count_common(col_mask(idx), bulbs) > 1
+                 ? first(coord, cell)
+                 : model::KEEP_VISITING;
+    });
+  }
+  return location;
+}
+
+bool
+BitboardPosition::is_solved() const {
+  return not has_error() && unsatisfied_walls_.none() &&
+         board_.plane(CellPlane::EMPTY).none() &&
+         board_.plane(CellPlane::MARK).none();
+}
+
+int
+BitboardPosition::num_cells_needing_illumination() const {
+  return board_.count(CellPlane::EMPTY) + board_.count(CellPlane::MARK);
+}
+
+int
+BitboardPosition::num_walls_with_deps() const {
+  return unsatisfied_walls_.count();
+}
+
+int
+BitboardPosition::light_count(Coord coord) const {
+  CellState const cell = get_cell(coord);
+  if (is_wall(cell)) {
+    return 0;
+  }
+  // a bulb is in its own segments, but doesn't light itself
+  int const        idx   = flat_idx(coord);
+  BitPlane const & bulbs = board_.plane(CellPlane::BULB);
+  return count_common(row_mask(idx), bulbs) +
+         count_common(col_mask(idx), bulbs) - 2 * is_bulb(cell);
+}
+
+} // namespace solver
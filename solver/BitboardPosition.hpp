@@ -0,0 +1,199 @@
+#pragma once
+
+#include "BasicBoard.hpp"
+#include "BitPlane.hpp"
+#include "CellState.hpp"
+#include "Coord.hpp"
+#include "DecisionType.hpp"
+#include "PositionBoard.hpp"
+#include "SegmentIndex.hpp"
+#include "SingleMove.hpp"
+#include <concepts>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace solver {
+
+// The part of PositionBoard's interface for playing bulbs and marks, and
+// asking about the result. BitboardPosition offers it too, so tests and
+// benchmarks can be written once for either.
+template <typename PositionT>
+concept PositionEngine = requires(PositionT &               position,
+                                  PositionT const &         cposition,
+                                  model::Coord              coord,
+                                  model::SingleMove const & move,
+                                  model::BasicBoard const & board) {
+  PositionT{board};
+  { position.add_bulb(coord) } -> std::same_as<bool>;
+  { position.add_mark(coord) } -> std::same_as<bool>;
+  { position.remove_bulb(coord) } -> std::same_as<bool>;
+  { position.remove_mark(coord) } -> std::same_as<bool>;
+  { position.apply_move(move) } -> std::same_as<bool>;
+  { cposition.has_error() } -> std::same_as<bool>;
+  { cposition.decision_type() } -> std::same_as<DecisionType>;
+  { cposition.get_ref_location() } -> std::same_as<model::OptCoord>;
+  { cposition.is_solved() } -> std::same_as<bool>;
+  { cposition.num_cells_needing_illumination() } -> std::same_as<int>;
+  { cposition.num_walls_with_deps() } -> std::same_as<int>;
+  { cposition.light_count(coord) } -> std::same_as<int>;
+  { cposition.get_cell(coord) } -> std::same_as<model::CellState>;
+  { cposition.board() } -> std::same_as<model::BasicBoard const &>;
+};
+
+// An alternative to PositionBoard that finds the light of the bulbs with bit
+// planes, rather than by walking each ray of light cell by cell. Every row
+// and column segment of the walls has a mask of its cells, so the lit cells
+// are the OR of the masks of the segments the bulbs are in, and bulbs see
+// each other when a segment holds more than one. Light is still written into
+// the cells it reaches, so the board reads the same as a PositionBoard's.
+//
+// Only bulbs and marks are played; the walls are those of the board it was
+// made from. Rather than reporting the most recent error, it reports the
+// first broken wall in row-major order, or else bulbs seeing each other.
+// A mask keeps only the words of a plane its cells are in, so the masks of a
+// layout take space in proportion to its cells; copies of a position share
+// them.
+class BitboardPosition {
+public:
+  using Coord     = model::Coord;
+  using CellState = model::CellState;
+
+  BitboardPosition() = default;
+  explicit BitboardPosition(model::BasicBoard const & board);
+
+  // Takes the walls, bulbs and marks of board, keeping any errors they make,
+  // as PositionBoard does with ResetPolicy::KEEP_ERRORS.
+  void reset(model::BasicBoard const & board);
+
+  bool add_bulb(Coord);
+  bool add_mark(Coord);
+  bool remove_bulb(Coord);
+  bool remove_mark(Coord);
+  bool apply_move(model::SingleMove const &);
+
+  bool            has_error() const;
+  DecisionType    decision_type() const;
+  model::OptCoord get_ref_location() const;
+
+  bool is_solved() const;
+  int  num_cells_needing_illumination() const;
+  int  num_walls_with_deps() const;
+
+  // how many bulbs shine on the cell (0 for walls)
+  int light_count(Coord) const;
+
+  int width() const;
+  int height() const;
+
+  CellState                 get_cell(Coord coord) const;
+  model::BasicBoard const & board() const;
+
+private:
+  // a word of a plane, holding some of the cells of a mask
+  struct MaskWord {
+    int                   word_idx;
+    model::BitPlane::Word bits;
+  };
+  using Mask = std::span<MaskWord const>;
+
+  // The masks of one direction's segments, by segment number: the words of
+  // segment s are words[starts[s]] up to words[starts[s + 1]].
+  struct SegmentMasks {
+    SegmentMasks(std::vector<Segment> const & segments,
+                 int                          width,
+                 int                          idx_step);
+
+    Mask mask(int segment) const;
+
+    std::vector<int>      starts;
+    std::vector<MaskWord> words;
+  };
+
+  // the masks of the segments of a wall layout
+  struct Layout {
+    explicit Layout(model::BasicBoard const & board);
+
+    SegmentIndex segments;
+    SegmentMasks row_masks;
+    SegmentMasks col_masks;
+  };
+
+  int flat_idx(Coord) const;
+
+  // the masks of the segments the (non-wall) cell at idx is in
+  Mask row_mask(int idx) const;
+  Mask col_mask(int idx) const;
+
+  // ORs mask into plane, and counts the cells of mask set in plane
+  static void add_mask(model::BitPlane & plane, Mask mask);
+  static int  count_common(Mask mask, model::BitPlane const & plane);
+
+  // lit_ from scratch: the OR of the masks of every bulb
+  void relight();
+
+  // Moves light into or out of the cells whose bits differ between lit_ and
+  // was_lit, and rechecks the walls next to them and to the played cell.
+  void update_cells(model::BitPlane const & was_lit, int played_idx);
+
+  void check_walls_near(model::BitPlane const & changed);
+  void check_wall(Coord, CellState);
+
+  std::shared_ptr<Layout const> layout_;
+  model::BasicBoard             board_;
+
+  // the cells in a segment with a bulb, including the bulbs
+  model::BitPlane lit_;
+
+  // the walls with deps that need more bulbs, and those that break a rule
+  model::BitPlane unsatisfied_walls_;
+  model::BitPlane broken_walls_;
+
+  int num_crowded_segments_ = 0;
+};
+
+static_assert(PositionEngine<PositionBoard>);
+static_assert(PositionEngine<BitboardPosition>);
+
+inline int
+BitboardPosition::flat_idx(Coord coord) const {
+  return coord.row_ * board_.width() + coord.col_;
+}
+
+inline BitboardPosition::Mask
+BitboardPosition::SegmentMasks::mask(int segment) const {
+  return Mask(words).subspan(starts[segment],
+                             starts[segment + 1] - starts[segment]);
+}
+
+inline BitboardPosition::Mask
+BitboardPosition::row_mask(int idx) const {
+  return layout_->row_masks.mask(layout_->segments.row_segment_of[idx]);
+}
+
+inline BitboardPosition::Mask
+BitboardPosition::col_mask(int idx) const {
+  return layout_->col_masks.mask(layout_->segments.col_segment_of[idx]);
+}
+
+inline int
+BitboardPosition::width() const {
+  return board_.width();
+}
+
+inline int
+BitboardPosition::height() const {
+  return board_.height();
+}
+
+inline model::CellState
+BitboardPosition::get_cell(Coord coord) const {
+  return board_.get_cell(coord);
+}
+
+inline model::BasicBoard const &
+BitboardPosition::board() const {
+  return board_;
+}
+
+} // namespace solver
@@ -0,0 +1,47 @@
+#include "ContextCache.hpp"
+#include <utility>
+#include <vector>
+
+namespace solver {
+
+namespace {
+
+std::vector<ContextCache> &
+pooled_caches() {
+  thread_local std::vector<ContextCache> caches;
+  return caches;
+}
+
+} // namespace
+
+ContextCache
+ContextCachePool::acquire() {
+  auto & caches = pooled_caches();
+  if (caches.empty()) {
+    return ContextCache{};
+  }
+  ContextCache cache = std::move(caches.back());
+  caches.pop_back();
+  return cache;
+}
+
+void
+ContextCachePool::release(ContextCache && cache) {
+  auto & caches = pooled_caches();
+  // (a board left mid-speculation keeps its checkpoints, so isn't reused)
+  if (caches.size() >= MAX_POOLED || cache.contexts.capacity() == 0 ||
+      cache.board.num_checkpoints() > 0) {
+    return;
+  }
+  if (caches.capacity() == 0) {
+    caches.reserve(MAX_POOLED);
+  }
+  caches.push_back(std::move(cache));
+}
+
+std::size_t
+ContextCachePool::num_pooled() {
+  return pooled_caches().size();
+}
+
+} // namespace solver
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "AnnotatedMove.hpp"
+#include "AnnotatedMoves.hpp"
+#include "PositionBoard.hpp"
+#include "SingleMove.hpp"
+#include "SpeculationContext.hpp"
+#include <cstddef>
+#include <vector>
+
+namespace solver {
+
+// The buffers a Solution reuses from one step to the next: its speculation
+// contexts, the scratch space for finding and playing moves, and the board
+// it plays on. Once grown to fit a board they are kept, so after the first
+// few steps of a solve, a step doesn't allocate.
+struct ContextCache {
+  using Indices     = std::vector<int>;
+  using IndicesIter = Indices::iterator;
+
+  SpeculationContexts            contexts;
+  Indices                        active_context_idxs;
+  Indices                        contradicting_context_idxs;
+  AnnotatedMoves                 forced_moves;
+  std::vector<model::SingleMove> moves;
+
+  // the trivial moves found for a step, and the moves waiting to be played
+  AnnotatedMoves             trivial_moves;
+  std::vector<AnnotatedMove> next_moves;
+
+  // holds the buffers of a solution's board while it is in the pool
+  PositionBoard board;
+};
+
+// The caches of finished solutions, kept for the next Solution made on the
+// same thread, so solving one board after another doesn't grow a new set of
+// buffers each time.
+class ContextCachePool {
+public:
+  // a pooled cache if there is one, else an empty one
+  static ContextCache acquire();
+
+  // keeps cache for a later acquire(), unless the pool is full or the cache
+  // has nothing worth keeping (such as one that has been moved from)
+  static void release(ContextCache && cache);
+
+  static std::size_t num_pooled();
+
+private:
+  // Solutions are normally made one at a time, but a few may be alive at
+  // once, such as when comparing a board against its solution.
+  static std::size_t constexpr MAX_POOLED = 4;
+};
+
+} // namespace solver
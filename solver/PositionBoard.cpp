@@ -1,11 +1,16 @@
 #include "PositionBoard.hpp"
 #include "BasicBoard.hpp"
+#include "BoardWidth.hpp"
 #include "CellState.hpp"
 #include "Coord.hpp"
 #include "DecisionType.hpp"
 #include "Direction.hpp"
 #include "utils/DebugLog.hpp"
+#include <array>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <utility>
 
 namespace solver {
 
@@ -26,45 +31,41 @@ void
 PositionBoard::reset(model::BasicBoard const &  current,
                      PositionBoard::ResetPolicy policy) {
   reset(current.height(), current.width());
-  num_cells_needing_illumination_ = 0;
 
-  Coord walls_with_deps[model::BasicBoard::MAX_CELLS];
-  int   num_walls_with_deps = 0;
-
-  // first copy the walls and update counts
-  current.visit_board([&](model::Coord coord, auto cell) {
-    if (model::is_dynamic_entity(cell)) {
-      num_cells_needing_illumination_++;
-    }
-    else if (is_wall(cell)) {
-      if (is_wall_with_deps(cell)) {
-        walls_with_deps[num_walls_with_deps++] = coord;
-      }
-      board_.set_cell(coord, cell);
-    }
+  // first copy the walls and update counts. (Cells needing illumination are
+  // counted by the board's planes, so only walls need to be found here.)
+  auto const & walls = current.plane(model::CellPlane::WALL);
+  current.visit_plane(walls, [&](model::Coord coord, auto cell) {
+    num_walls_with_deps_ += is_wall_with_deps(cell);
+    store_cell(coord, cell);
   });
-  num_walls_with_deps_ = num_walls_with_deps;
 
   // Now update each wall to determine validity
-  for (int i = 0; i < num_walls_with_deps; ++i) {
-    auto coord = walls_with_deps[i];
-    auto cell  = board_.get_cell(coord);
-
+  bool const walls_ok = current.visit_plane(walls, [&](Coord coord, auto cell) {
+    if (not is_wall_with_deps(cell)) {
+      return model::KEEP_VISITING;
+    }
     // ensure each wall with deps is in a valid state
     update_wall(coord, cell, cell, false);
-    if (has_error() && policy == ResetPolicy::STOP_PLAYING_MOVES_ON_ERROR) {
-      return;
-    }
+    return has_error() && policy == ResetPolicy::STOP_PLAYING_MOVES_ON_ERROR
+               ? model::STOP_VISITING
+               : model::KEEP_VISITING;
+  });
+  if (not walls_ok) {
+    return;
   }
 
-  current.visit_board([&](model::Coord coord, auto cell) {
+  // replay bulbs and marks together, preserving their row-major order
+  auto const bulbs_and_marks = current.plane(model::CellPlane::BULB) |
+                               current.plane(model::CellPlane::MARK);
+  current.visit_plane(bulbs_and_marks, [&](model::Coord coord, auto cell) {
     if (has_error() && policy == ResetPolicy::STOP_PLAYING_MOVES_ON_ERROR) {
       return model::STOP_VISITING;
     }
     if (model::is_bulb(cell)) {
       add_bulb(coord);
     }
-    else if (is_mark(cell)) {
+    else {
       add_mark(coord);
     }
     return model::KEEP_VISITING;
@@ -85,71 +86,218 @@ PositionBoard::reevaluate_board_state(PositionBoard::ResetPolicy policy) {
   // our underlying is non-destructive way to evaluate our current board
   // without any changes to our current board or state, and then we can just
   // take the results.
-  PositionBoard paranoid(board_, policy);
-  has_error_                      = paranoid.has_error_;
-  num_cells_needing_illumination_ = paranoid.num_cells_needing_illumination_;
-  num_walls_with_deps_            = paranoid.num_walls_with_deps_;
-  decision_type_                  = paranoid.decision_type_;
-  ref_location_                   = paranoid.ref_location_;
-  board_                          = paranoid.board_;
+  set_position(PositionBoard(board_, policy));
 }
 
-bool
-PositionBoard::set_cell(model::Coord     coord,
-                        model::CellState cell,
-                        SetCellPolicy    policy) {
-
-  // for known simple cases, try to not recompute the state unless forced to.
-  // For a policy of FORCE_REEVALUATE_BOARD we can't bypass these shortcuts and
-  // will reevaluate the board unconditionally.
-  if (policy == SetCellPolicy::REEVALUATE_IF_NECESSARY) {
-    // these replace the simple
-    auto orig_cell = board_.get_cell(coord);
-    if (cell == orig_cell) {
-      return true;
+void
+PositionBoard::set_position(PositionBoard const & other) {
+  model::BasicBoard const & other_board = other.board_;
+  if (not checkpoints_.empty()) {
+    if (other.height() != height() || other.width() != width()) {
+      throw std::runtime_error(
+          "Cannot change dimensions of a board with checkpoints");
     }
-
-    // changing empty to something known how to handle:
-    if (is_empty(orig_cell)) {
-      switch (cell) {
-        case CellState::BULB:
-          return add_bulb(coord);
-        case CellState::MARK:
-          return add_mark(coord);
-        default:
-          if (is_wall(cell)) {
-            if (add_wall(coord, cell)) {
-              return true;
-            }
-          }
-          break;
+    for (int idx = 0, e = height() * width(); idx < e; ++idx) {
+      if (board_.get_cell_flat_unchecked(idx) !=
+              other_board.get_cell_flat_unchecked(idx) ||
+          light_counts_[idx] != other.light_counts_[idx]) {
+        save_cell(idx);
       }
     }
-    else if (orig_cell == CellState::ILLUM && not has_error()) {
-      if (is_wall(cell)) {
-        return add_wall(coord, cell);
-      }
+  }
+  violations_          = other.violations_;
+  num_walls_with_deps_ = other.num_walls_with_deps_;
+  needs_reevaluation_  = other.needs_reevaluation_;
+  board_               = other_board;
+  light_counts_        = other.light_counts_;
+  lit_                 = other.lit_;
+  tallies_             = other.tallies_;
+
+  if (other.segments_) {
+    segments_            = other.segments_;
+    row_segment_empties_ = other.row_segment_empties_;
+    col_segment_empties_ = other.col_segment_empties_;
+  }
+  else if (segments_ &&
+           segments_->walls == board_.plane(model::CellPlane::WALL)) {
+    count_segment_empties();
+  }
+  else {
+    segments_.reset();
+  }
+}
+
+void
+PositionBoard::track_segment_empties() {
+  if (not segments_) {
+    segments_ = std::make_shared<SegmentIndex const>(board_);
+    count_segment_empties();
+  }
+}
+
+void
+PositionBoard::count_segment_empties() {
+  row_segment_empties_.assign(segments_->row_segments.size(), 0);
+  col_segment_empties_.assign(segments_->col_segments.size(), 0);
+  board_.plane(model::CellPlane::EMPTY).visit_set_bits([&](int idx) {
+    if (not lit_.test(idx)) {
+      adjust_segment_empties(idx, 1);
     }
+  });
+}
 
-    // removing something known how to handle
-    else if (is_empty(cell)) {
-      switch (orig_cell) {
-        case CellState::BULB:
-          return remove_bulb(coord);
-          // case CellState::MARK:
-          //   return remove_mark(coord);
+void
+PositionBoard::set_illum_policy(IllumPolicy policy) {
+  illum_policy_ = policy;
+  materialize();
+}
 
-        default:
-          break;
-      }
+void
+PositionBoard::materialize() {
+  // Not logged: rolling back restores the cells changed since the checkpoint,
+  // and the rest are as lit as they were.
+  if (has_deferred_light()) {
+    board_.visit_plane(board_.plane(model::CellPlane::EMPTY) & lit_,
+                       [this](Coord coord, CellState) {
+                         board_.set_cell(coord, CellState::ILLUM);
+                       });
+  }
+}
+
+bool
+PositionBoard::has_deferred_light() const {
+  return lit_.count_common(board_.plane(model::CellPlane::EMPTY)) > 0;
+}
+
+void
+PositionBoard::checkpoint() {
+  checkpoints_.push_back(Checkpoint{trail_.size(),
+                                    violations_,
+                                    num_walls_with_deps_,
+                                    board_.get_last_move_coord(),
+                                    needs_reevaluation_,
+                                    segments_});
+}
+
+void
+PositionBoard::rollback() {
+  assert(not checkpoints_.empty());
+  Checkpoint const & checkpoint = checkpoints_.back();
+
+  // The segment counts only follow the restored cells if the segments are
+  // the checkpoint's. A wall change since then dropped them, or they were
+  // started for other walls, so they are counted again once the cells are
+  // restored. Tracking started since the checkpoint is kept.
+  bool const segments_changed = segments_ != checkpoint.segments;
+  std::shared_ptr<SegmentIndex const> tracked_since;
+  if (segments_changed) {
+    tracked_since = std::exchange(segments_, nullptr);
+  }
+  while (trail_.size() > checkpoint.trail_size) {
+    SavedCell const & saved = trail_.back();
+    Coord const coord =
+        model::coord_of(saved.idx, model::DynamicWidth{width()});
+    store_cell(coord, saved.cell);
+    set_light_count(coord, saved.light_count);
+    trail_.pop_back();
+  }
+  violations_          = checkpoint.violations;
+  num_walls_with_deps_ = checkpoint.num_walls_with_deps;
+  needs_reevaluation_  = checkpoint.needs_reevaluation;
+  board_.set_last_move_coord(checkpoint.last_move_coord);
+
+  if (segments_changed) {
+    if (checkpoint.segments) {
+      segments_ = checkpoint.segments;
+    }
+    else if (tracked_since->walls == board_.plane(model::CellPlane::WALL)) {
+      segments_ = std::move(tracked_since);
     }
+    else {
+      segments_ = std::make_shared<SegmentIndex const>(board_);
+    }
+    count_segment_empties();
+  }
+  checkpoints_.pop_back();
+}
+
+void
+PositionBoard::drop_checkpoint() {
+  assert(not checkpoints_.empty());
+  checkpoints_.pop_back();
+  if (checkpoints_.empty()) {
+    trail_.clear();
+  }
+}
+
+bool
+PositionBoard::set_cell(model::Coord     coord,
+                        model::CellState cell,
+                        SetCellPolicy    policy) {
+  CellState const orig_cell = get_cell(coord);
+  if (policy == SetCellPolicy::REEVALUATE_IF_NECESSARY && cell == orig_cell) {
+    return true;
   }
-  bool result = board_.set_cell(coord, cell);
+
+  // Changes between empty, bulb, mark and wall cells, and covering a lit cell
+  // with a wall, are made incrementally. Unless forced to reevaluate, playing
+  // or removing bulbs or marks and adding walls to empty cells is done that way
+  // even if the position was allowed to go out of sync with its board.
+  auto const changeable = CellState::EMPTY | CellState::BULB | CellState::MARK |
+                          model::cellstategroups::any_wall;
+  bool const incremental =
+      cell != orig_cell &&
+      (orig_cell == (orig_cell & changeable) ||
+       (orig_cell == CellState::ILLUM && is_wall(cell))) &&
+      cell == (cell & changeable);
+  bool const simple_play =
+      is_empty(orig_cell) || orig_cell == CellState::ILLUM ||
+      (is_empty(cell) && (is_bulb(orig_cell) || is_mark(orig_cell)));
+
+  if (incremental && policy != SetCellPolicy::NO_REEVALUATE_BOARD &&
+      (not needs_reevaluation_ ||
+       (simple_play && policy == SetCellPolicy::REEVALUATE_IF_NECESSARY))) {
+    return change_cell(coord, cell);
+  }
+
+  bool result = write_cell(coord, cell);
 
   // unless explicitly forbidden, we should reevaluate after set_cell
   if (policy != SetCellPolicy::NO_REEVALUATE_BOARD) {
     reevaluate_board_state(PositionBoard::ResetPolicy::KEEP_ERRORS);
   }
+  else {
+    needs_reevaluation_ = true;
+  }
+  return result;
+}
+
+bool
+PositionBoard::change_cell(model::Coord coord, model::CellState cell) {
+  // First clear the cell, unless only changing the deps of a wall
+  CellState const orig_cell = get_cell(coord);
+  if (is_bulb(orig_cell)) {
+    remove_bulb(coord);
+  }
+  else if (is_mark(orig_cell)) {
+    remove_mark(coord);
+  }
+  else if (is_wall(orig_cell) && not is_wall(cell)) {
+    remove_wall(coord);
+  }
+
+  // then put the new contents there
+  bool result = true;
+  if (is_bulb(cell)) {
+    result = add_bulb(coord);
+  }
+  else if (is_mark(cell)) {
+    result = add_mark(coord);
+  }
+  else if (is_wall(cell)) {
+    result = add_wall(coord, cell);
+  }
+  board_.set_last_move_coord(coord);
   return result;
 }
 
@@ -160,23 +308,29 @@ PositionBoard::board() const {
 
 model::BasicBoard &
 PositionBoard::mut_board() {
+  materialize();
+  needs_reevaluation_ = true;
   return board_;
 }
 
 bool
 PositionBoard::is_solved() const {
-  return has_error_ == false && num_walls_with_deps_ == 0 &&
-         num_cells_needing_illumination_ == 0;
+  auto const & empties = board_.plane(model::CellPlane::EMPTY);
+  return violations_.empty() && num_walls_with_deps_ == 0 &&
+         empties.count_common(lit_) == empties.count() &&
+         board_.plane(model::CellPlane::MARK).none();
 }
 
 bool
 PositionBoard::is_ambiguous() const {
-  return decision_type_ == DecisionType::VIOLATES_SINGLE_UNIQUE_SOLUTION;
+  return decision_type() == DecisionType::VIOLATES_SINGLE_UNIQUE_SOLUTION;
 }
 
 int
 PositionBoard::num_cells_needing_illumination() const {
-  return num_cells_needing_illumination_;
+  auto const & empties = board_.plane(model::CellPlane::EMPTY);
+  return empties.count() - empties.count_common(lit_) +
+         board_.count(model::CellPlane::MARK);
 }
 
 int
@@ -195,26 +349,99 @@ PositionBoard::height() const {
 
 bool
 PositionBoard::has_error() const {
-  return has_error_;
+  return not violations_.empty();
 }
 
 void
 PositionBoard::set_has_error(bool            yn,
                              DecisionType    decision,
                              model::OptCoord location) {
-  has_error_     = yn;
-  decision_type_ = decision;
-  ref_location_  = location;
+  if (yn) {
+    add_violation({decision, location, std::nullopt});
+  }
+  else if (not violations_.empty()) {
+    // the board still breaks the rules, but we no longer know it
+    needs_reevaluation_ = true;
+    violations_.clear();
+  }
+}
+
+std::vector<PositionBoard::Violation> const &
+PositionBoard::violations() const {
+  return violations_;
 }
 
 DecisionType
 PositionBoard::decision_type() const {
-  return decision_type_;
+  return violations_.empty() ? DecisionType::NONE : violations_.back().type;
 }
 
 model::OptCoord
 PositionBoard::get_ref_location() const {
-  return ref_location_;
+  return violations_.empty() ? std::nullopt : violations_.back().location;
+}
+
+void
+PositionBoard::add_violation(Violation violation) {
+  std::erase_if(violations_, [&](Violation const & v) {
+    return v == violation ||
+           (v.type == DecisionType::BULBS_SEE_EACH_OTHER &&
+            v.type == violation.type && v.location == violation.other &&
+            v.other == violation.location);
+  });
+  violations_.push_back(violation);
+}
+
+void
+PositionBoard::clear_fixed_violations() {
+  std::erase_if(violations_,
+                [this](Violation const & v) { return not holds(v); });
+}
+
+bool
+PositionBoard::holds(Violation const & violation) const {
+  if (not violation.location) {
+    return true;
+  }
+  Coord const coord = *violation.location;
+  CellState const cell = get_cell(coord);
+  switch (violation.type) {
+    case DecisionType::WALL_HAS_TOO_MANY_BULBS:
+    case DecisionType::WALL_CANNOT_BE_SATISFIED: {
+      int const empty_neighbors = num_adjacent_empties(coord);
+      int const bulb_neighbors  = num_adjacent_bulbs(coord);
+      int const deps            = model::num_wall_deps(cell);
+      return is_wall_with_deps(cell) &&
+             (violation.type == DecisionType::WALL_HAS_TOO_MANY_BULBS
+                  ? bulb_neighbors > deps
+                  : deps - bulb_neighbors > empty_neighbors);
+    }
+
+    case DecisionType::BULBS_SEE_EACH_OTHER: {
+      // they must still be bulbs, with nothing but light between them
+      Coord const other = *violation.other;
+      if (not is_bulb(cell) || not is_bulb(get_cell(other))) {
+        return false;
+      }
+      bool sees = false;
+      board_.visit_rows_cols_outward(coord, [&](Coord pos, CellState) {
+        sees |= pos == other;
+      });
+      return sees;
+    }
+
+    case DecisionType::MARK_CANNOT_BE_ILLUMINATED: {
+      // a bulb could still go in an empty cell in its row or column
+      bool has_empty = false;
+      board_.visit_rows_cols_outward(coord, [&](Coord seen_coord, CellState) {
+        has_empty |= is_empty(get_cell(seen_coord));
+      });
+      return is_mark(cell) && not has_empty;
+    }
+
+    default:
+      return true;
+  }
 }
 
 // Handles a state change when a light is played:
@@ -228,27 +455,19 @@ PositionBoard::update_wall(model::Coord wall_coord,
                            CellState    wall_cell,
                            CellState    play_cell,
                            bool         coord_is_adjacent_to_play) {
-  assert(wall_cell == get_cell(wall_coord));
+  assert(wall_cell == board_.get_cell(wall_coord));
 
   if (int deps = model::num_wall_deps(wall_cell); deps > 0) {
-
-    int empty_neighbors = 0;
-    int bulb_neighbors  = 0;
-    board().visit_adjacent(wall_coord,
-                           [&](model::Coord coord, CellState neighbor) {
-                             bulb_neighbors += neighbor == CellState::BULB;
-                             empty_neighbors += neighbor == CellState::EMPTY;
-                           });
+    int const empty_neighbors = num_adjacent_empties(wall_coord);
+    int const bulb_neighbors  = num_adjacent_bulbs(wall_coord);
 
     if (bulb_neighbors > deps) {
-      has_error_     = true;
-      decision_type_ = DecisionType::WALL_HAS_TOO_MANY_BULBS;
-      ref_location_  = wall_coord;
+      add_violation(
+          {DecisionType::WALL_HAS_TOO_MANY_BULBS, wall_coord, std::nullopt});
     }
     else if ((deps - bulb_neighbors) > empty_neighbors) {
-      has_error_     = true;
-      decision_type_ = DecisionType::WALL_CANNOT_BE_SATISFIED;
-      ref_location_  = wall_coord;
+      add_violation(
+          {DecisionType::WALL_CANNOT_BE_SATISFIED, wall_coord, std::nullopt});
     }
     else if (bulb_neighbors == deps && coord_is_adjacent_to_play &&
              play_cell == CellState::BULB) {
@@ -261,59 +480,44 @@ PositionBoard::update_wall(model::Coord wall_coord,
 }
 
 void
-PositionBoard::remove_illum_in_direction_from(model::Coord start_at,
-                                              Direction    direction) {
-  visit_rows_cols_outward(
+PositionBoard::dim_rays(model::Coord start_at, Direction directions) {
+  board_.visit_rows_cols_outward(
       start_at,
-      [this, direction](Coord coord, CellState cell) {
-        if (cell == CellState::ILLUM) {
-          bool has_crossbeam = false;
-          visit_perpendicular(
-              coord, direction, [&](auto, CellState cross_cell) {
-                has_crossbeam |= is_bulb(cross_cell);
-              });
-          if (not has_crossbeam) {
-            board_.set_cell(coord, CellState::EMPTY);
-            ++num_cells_needing_illumination_;
-          }
+      [this](Coord coord, CellState cell) {
+        if (is_wall(cell)) {
+          return;
+        }
+        int const idx = flat_idx(coord);
+        save_cell(idx);
+        set_light_count(coord, light_counts_[idx] - 1);
+        if (light_counts_[idx] == 0 && cell == CellState::ILLUM) {
+          store_cell(coord, CellState::EMPTY);
         }
       },
-      direction);
+      directions);
 }
 
 bool
 PositionBoard::add_wall(model::Coord wall_coord, model::CellState wall_cell) {
   assert(is_wall(wall_cell));
   CellState const orig_cell = get_cell(wall_coord);
-  if (not is_empty(orig_cell)) {
-    // When placing a wall in an empty cell, the board state can remain
-    // the same or enter an error state (e.g. wall is unsatisfiable, or
-    // makes a neighbor unsatisfiable.) But can never REMOVE an error
-    // state once set. That's beyond the bookkeeping of this class without
-    // starting clean and building up the state again and visiting the
-    // whole board. (If there are 2 errors, and we fix one, we don't know
-    // it since there's only a bool.) So don't allow cases that could fix
-    // errors, and require the slow rebuilding appraoch. Therefore, if
-    // there is an error, we cannot allow adding a wall except on empty
-    // tiles (or we might report an error that no longer exists.)
-    if (has_error_) {
-      return false;
-    }
+  if (is_bulb(orig_cell) || is_mark(orig_cell)) {
+    return false;
   }
-
-  board_.set_cell(wall_coord, wall_cell);
-
-  if (model::is_illuminable(orig_cell)) {
-    --num_cells_needing_illumination_;
+  segments_.reset();
+
+  // A wall counts as having deps while it needs more bulbs. (WALL0 never
+  // does.) Replacing a wall only changes its deps, which no other cell
+  // depends on.
+  int const bulb_neighbors = num_adjacent_bulbs(wall_coord);
+  if (is_wall(orig_cell)) {
+    num_walls_with_deps_ -= bulb_neighbors < model::num_wall_deps(orig_cell);
   }
+  write_cell(wall_coord, wall_cell);
+  num_walls_with_deps_ += bulb_neighbors < model::num_wall_deps(wall_cell);
+  update_wall(wall_coord, wall_cell, wall_cell, false);
 
-  // This wall deps counter logic works even with WALL0, which has no
-  // deps, because WALL0 is pathologically satisfied.
-  num_walls_with_deps_++;
-  bool is_satisfied = update_wall(wall_coord, wall_cell, wall_cell, false);
-  num_walls_with_deps_ -= is_satisfied;
-
-  visit_adjacent(wall_coord, [&](Coord adj_coord, CellState adj_cell) {
+  board_.visit_adjacent(wall_coord, [&](Coord adj_coord, CellState adj_cell) {
     update_wall(adj_coord, adj_cell, adj_cell, false);
   });
 
@@ -335,39 +539,111 @@ PositionBoard::add_wall(model::Coord wall_coord, model::CellState wall_cell) {
   // Note it blocks the light except in the column at the right since it's
   // still illuminated from above.
 
-  //
-  // ALSO: we are not in an error state, so don't have to check or handle
-  // the case where two lights can see each other.
-  //
+  // If two bulbs could see each other through the cell, that error is fixed.
   if (orig_cell == CellState::ILLUM) {
-    // find light source(s)
-    model::Direction light_sources{};
-    visit_rows_cols_outward(
+    // find light source(s), and take their light away from the cells past
+    // the wall
+    set_light_count(wall_coord, 0); // saved by write_cell above
+    board_.visit_rows_cols_outward(
         wall_coord, [&](Direction dir, Coord coord, CellState cell) {
           if (is_bulb(cell)) {
-            // clear illumination in other direction from bulb
-            remove_illum_in_direction_from(wall_coord, flip(dir));
+            dim_rays(wall_coord, flip(dir));
           }
         });
   }
 
+  clear_fixed_violations();
   return true;
 }
 
 bool
 PositionBoard::remove_bulb(model::Coord bulb_coord) {
-  // TODO: this is inefficient logic since it recomputes the board from the
-  // beginning after removing the bulb.  But it works, and is a placeholder
-  // until I feel like dealing with it better.
-  board_.set_cell(bulb_coord, model::CellState::EMPTY);
-  auto board_copy = board_;
-
-  // an unsolved board is an error, but we don't want that to stop us from
-  // copying the moves back into the new board.
-  reset(board_copy, PositionBoard::ResetPolicy::KEEP_ERRORS);
+  if (not is_bulb(get_cell(bulb_coord))) {
+    return false;
+  }
+
+  // Unless another bulb sees this one (an error), its cell is left unlit.
+  bool const is_lit = light_counts_[flat_idx(bulb_coord)] > 0;
+  write_cell(bulb_coord, is_lit ? CellState::ILLUM : CellState::EMPTY);
+
+  // adjacent walls that this bulb satisfied are no longer satisfied, and if
+  // its cell is lit, can't have a bulb there instead.
+  board_.visit_adjacent(bulb_coord, [&](Coord wall_coord, CellState cell) {
+    if (int deps = model::num_wall_deps(cell); deps > 0) {
+      num_walls_with_deps_ += num_adjacent_bulbs(wall_coord) + 1 == deps;
+      if (is_lit) {
+        update_wall(wall_coord, cell, CellState::ILLUM, false);
+      }
+    }
+  });
+
+  dim_rays(bulb_coord, model::directiongroups::all);
+  clear_fixed_violations();
+  return true;
+}
+
+bool
+PositionBoard::remove_mark(model::Coord mark_coord) {
+  if (not is_mark(get_cell(mark_coord))) {
+    return false;
+  }
+  // Nothing else changes: the mark wasn't lit, and its neighbors only have
+  // one more empty cell to place bulbs in, which can fix errors.
+  write_cell(mark_coord, CellState::EMPTY);
+  clear_fixed_violations();
+  return true;
+}
+
+bool
+PositionBoard::remove_wall(model::Coord wall_coord) {
+  CellState const wall_cell = get_cell(wall_coord);
+  if (not is_wall(wall_cell)) {
+    return false;
+  }
+  segments_.reset();
+  num_walls_with_deps_ -=
+      num_adjacent_bulbs(wall_coord) < model::num_wall_deps(wall_cell);
+
+  // find the bulbs whose light the wall was blocking
+  struct Source {
+    Direction dir;
+    Coord     bulb_coord;
+  };
+  std::array<Source, 4> sources;
+  int                   num_sources = 0;
+  board_.visit_rows_cols_outward(
+      wall_coord, [&](Direction dir, Coord coord, CellState cell) {
+        if (is_bulb(cell)) {
+          sources[num_sources++] = {dir, coord};
+        }
+      });
+
+  // Its neighbors gain an empty or illuminated cell, which can't make a wall
+  // any harder to satisfy. Then the light passes through to the cells behind,
+  // and may reach another bulb.
+  write_cell(wall_coord,
+             num_sources > 0 ? CellState::ILLUM : CellState::EMPTY);
+  set_light_count(wall_coord, num_sources); // saved by write_cell
+  for (int i = 0; i < num_sources; ++i) {
+    shine_rays(sources[i].bulb_coord, wall_coord, flip(sources[i].dir));
+  }
+  clear_fixed_violations();
   return true;
 }
 
+void
+PositionBoard::adjust_neighbor_tallies(model::Coord coord,
+                                       int          empties,
+                                       int          bulbs) {
+  // the border takes the changes of cells on the edge
+  int const idx    = tally_idx(coord);
+  int const stride = width() + 2;
+  for (int adj : {idx - stride, idx - 1, idx + 1, idx + stride}) {
+    tallies_[adj].empties += empties;
+    tallies_[adj].bulbs += bulbs;
+  }
+}
+
 bool
 PositionBoard::add_bulb(model::Coord bulb_coord) {
   CellState bulb_target = get_cell(bulb_coord);
@@ -376,54 +652,89 @@ PositionBoard::add_bulb(model::Coord bulb_coord) {
   if (bulb_target != (bulb_target & (CellState::EMPTY | CellState::ILLUM))) {
     return false;
   }
-  mut_board().set_cell(bulb_coord, CellState::BULB);
-  num_cells_needing_illumination_ -= bulb_target == CellState::EMPTY;
+  write_cell(bulb_coord, CellState::BULB);
 
   // update walls immediately adjacent to the bulb
-  board().visit_adjacent(
+  board_.visit_adjacent(
       bulb_coord, [&](model::Coord adj_coord, CellState neighbor) {
         update_wall(adj_coord, neighbor, CellState::BULB, true);
       });
 
-  // now emit light outwards, and see if it affects walls nearby
-  board().visit_rows_cols_outward(
-      bulb_coord, [&](Direction dir, model::Coord coord, CellState cell) {
+  // now emit light outwards, and see if it affects walls nearby, or lights
+  // marks that couldn't be
+  shine_rays(bulb_coord, bulb_coord, model::directiongroups::all);
+  clear_fixed_violations();
+  return true;
+}
+
+void
+PositionBoard::cast_light(model::Coord bulb_coord,
+                          model::Coord start_at,
+                          Direction    directions,
+                          auto &&      on_reached) {
+  board_.visit_rows_cols_outward(
+      start_at,
+      [&](Direction dir, model::Coord coord, CellState cell) {
+        if (not is_wall(cell)) {
+          int const idx = flat_idx(coord);
+          if (is_empty(cell) && light_counts_[idx] > 0) {
+            cell = CellState::ILLUM; // lit, but not yet written
+          }
+          save_cell(idx);
+          set_light_count(coord, light_counts_[idx] + 1);
+        }
         if (is_illuminable(cell)) {
-          mut_board().set_cell(coord, model::CellState::ILLUM);
-          num_cells_needing_illumination_--;
-
-          // illuminating a cell adjacent to a wall with deps affects it. Only
-          // check left/right (flank) because looking ahead is redundant since
-          // we are walking in that direction anyway and will process when we
-          // get there. Don't look behind because it's already processed.
-          board().visit_adj_flank(
-              coord, dir, [&](model::Coord adj_coord, CellState neighbor) {
-                update_wall(adj_coord, neighbor, CellState::ILLUM, false);
-              });
+          if (not is_empty(cell) ||
+              illum_policy_ == IllumPolicy::WRITE_WHEN_LIT) {
+            store_cell(coord, model::CellState::ILLUM); // saved above
+          }
+          on_reached(dir, coord, cell);
         }
         else if (is_bulb(cell)) {
-          decision_type_ = DecisionType::BULBS_SEE_EACH_OTHER;
-          has_error_     = true;
-          ref_location_  = bulb_coord;
+          add_violation(
+              {DecisionType::BULBS_SEE_EACH_OTHER, bulb_coord, coord});
         }
-        else if (is_wall_with_deps(cell)) {
+        else if (is_wall(cell)) {
+          on_reached(dir, coord, cell);
+        }
+      },
+      directions);
+}
+
+void
+PositionBoard::shine_rays(model::Coord bulb_coord,
+                          model::Coord start_at,
+                          Direction    directions) {
+  cast_light(
+      bulb_coord,
+      start_at,
+      directions,
+      [&](Direction dir, model::Coord coord, CellState cell) {
+        if (is_wall(cell)) {
           update_wall(coord, cell, CellState::ILLUM, false);
+          return;
         }
+        // illuminating a cell adjacent to a wall with deps affects it. Only
+        // check left/right (flank) because looking ahead is redundant since
+        // we are walking in that direction anyway and will process when we
+        // get there. Don't look behind because it's already processed.
+        board_.visit_adj_flank(
+            coord, dir, [&](model::Coord adj_coord, CellState neighbor) {
+              update_wall(adj_coord, neighbor, CellState::ILLUM, false);
+            });
       });
-
-  return true;
 }
 
 bool
 PositionBoard::add_mark(model::Coord mark_coord) {
-  CellState mark_target = board().get_cell(mark_coord);
+  CellState mark_target = get_cell(mark_coord);
   if (not is_empty(mark_target)) {
     return false;
   }
-  mut_board().set_cell(mark_coord, CellState::MARK);
+  write_cell(mark_coord, CellState::MARK);
 
   // update walls immediately adjacent to the mark
-  board().visit_adjacent(
+  board_.visit_adjacent(
       mark_coord, [&](model::Coord neighbor_coord, CellState neighbor_cell) {
         update_wall(neighbor_coord, neighbor_cell, CellState::MARK, true);
       });
@@ -454,6 +765,234 @@ PositionBoard::apply_move(const model::SingleMove & move) {
   return false;
 }
 
+std::size_t
+PositionBoard::apply_moves(std::span<model::SingleMove const> moves) {
+  if (can_place_together(moves)) {
+    checkpoint();
+    int const last_played = place_moves(moves);
+    if (not has_error()) {
+      // Errors only accumulate as bulbs and marks are added, so none of the
+      // moves made one. Once the board is solved, it refuses the rest.
+      drop_checkpoint();
+      return is_solved() ? last_played + 1 : moves.size();
+    }
+    rollback();
+  }
+
+  std::size_t num_played = 0;
+  for (auto const & move : moves) {
+    apply_move(move);
+    ++num_played;
+    if (has_error() || is_solved()) {
+      break;
+    }
+  }
+  return num_played;
+}
+
+bool
+PositionBoard::can_place_together(
+    std::span<model::SingleMove const> moves) const {
+  if (moves.size() < 2 || needs_reevaluation_ || has_error() || is_solved()) {
+    return false;
+  }
+  model::BitPlane targets(height() * width());
+  for (auto const & move : moves) {
+    if (move.action_ != model::Action::ADD ||
+        (move.to_ != CellState::BULB && move.to_ != CellState::MARK) ||
+        not move.coord_.in_range(height(), width()) ||
+        targets.test(flat_idx(move.coord_))) {
+      return false;
+    }
+    // a bulb is refused over a mark, unless another bulb lights it first
+    if (move.to_ == CellState::BULB && is_mark(get_cell(move.coord_))) {
+      return false;
+    }
+    targets.set(flat_idx(move.coord_));
+  }
+  return true;
+}
+
+int
+PositionBoard::place_moves(std::span<model::SingleMove const> moves) {
+  model::OptCoord const orig_last_move = board_.get_last_move_coord();
+
+  // The walls next to cells that change from empty are checked once, at the
+  // end, rather than after each move or ray of light.
+  model::BitPlane walls(height() * width());
+  model::BitPlane placed(height() * width());
+  model::BitPlane bulbs(height() * width());
+  auto const      check_wall = [&](Coord coord, CellState cell) {
+    if (is_wall_with_deps(cell)) {
+      walls.set(flat_idx(coord));
+    }
+  };
+
+  // First put the bulbs and marks down where add_bulb and add_mark would
+  // accept them, counting the walls the bulbs satisfy.
+  for (auto const & move : moves) {
+    Coord const     coord = move.coord_;
+    CellState const cell  = get_cell(coord);
+    if (move.to_ == CellState::BULB &&
+        cell == (cell & (CellState::EMPTY | CellState::ILLUM))) {
+      board_.visit_adjacent(coord, [&](Coord wall_coord, CellState adj_cell) {
+        int const deps = model::num_wall_deps(adj_cell);
+        num_walls_with_deps_ -=
+            deps > 0 && num_adjacent_bulbs(wall_coord) + 1 == deps;
+      });
+      write_cell(coord, CellState::BULB);
+      bulbs.set(flat_idx(coord));
+    }
+    else if (move.to_ == CellState::MARK && is_empty(cell)) {
+      write_cell(coord, CellState::MARK);
+    }
+    else {
+      continue;
+    }
+    board_.visit_adjacent(coord, check_wall);
+    placed.set(flat_idx(coord));
+  }
+
+  // then let the bulbs shine, which lights the marks in their way. As in
+  // shine_rays, only the flanks of a lit cell need to be looked at.
+  board_.visit_plane(bulbs, [&](Coord bulb_coord, CellState) {
+    cast_light(bulb_coord,
+               bulb_coord,
+               model::directiongroups::all,
+               [&](Direction dir, Coord coord, CellState cell) {
+                 if (is_wall(cell)) {
+                   check_wall(coord, cell);
+                 }
+                 else {
+                   board_.visit_adj_flank(coord, dir, check_wall);
+                 }
+               });
+  });
+  board_.visit_plane(walls, [&](Coord wall_coord, CellState wall_cell) {
+    update_wall(wall_coord, wall_cell, wall_cell, false);
+  });
+
+  // Played one at a time, a mark would be refused if a bulb played before it
+  // had already lit its cell.
+  auto const refused = [&](int move_idx) {
+    Coord const coord = moves[move_idx].coord_;
+    if (not placed.test(flat_idx(coord))) {
+      return true;
+    }
+    if (is_bulb(get_cell(coord)) || is_mark(get_cell(coord))) {
+      return false;
+    }
+    bool lit_before = false;
+    board_.visit_rows_cols_outward(coord, [&](Coord seen, CellState cell) {
+      if (is_bulb(cell)) {
+        lit_before |= std::ranges::any_of(
+            moves.first(move_idx),
+            [&](auto const & move) { return move.coord_ == seen; });
+      }
+    });
+    return lit_before;
+  };
+  int last_played = static_cast<int>(moves.size()) - 1;
+  while (last_played >= 0 && refused(last_played)) {
+    --last_played;
+  }
+  board_.set_last_move_coord(last_played >= 0 ? moves[last_played].coord_
+                                              : orig_last_move);
+  return last_played;
+}
+
+PositionBoard::MovePreview
+PositionBoard::preview(model::SingleMove const & move) const {
+  int const   num_cells = height() * width();
+  MovePreview preview;
+  preview.satisfied_walls.resize(num_cells);
+  preview.broken_walls.resize(num_cells);
+
+  Coord const coord = move.coord_;
+  if (move.action_ != model::Action::ADD ||
+      not coord.in_range(height(), width())) {
+    return preview;
+  }
+  CellState const cell      = get_cell(coord);
+  bool const      adds_bulb = move.to_ == CellState::BULB;
+  if (adds_bulb ? cell != (cell & (CellState::EMPTY | CellState::ILLUM))
+                : (move.to_ != CellState::MARK || not is_empty(cell))) {
+    return preview;
+  }
+  preview.accepted = true;
+
+  // the cells that would stop being empty: the one played, if it is, and
+  // those a bulb would light
+  model::BitPlane filled(num_cells);
+  if (is_empty(cell)) {
+    filled.set(flat_idx(coord));
+  }
+  if (adds_bulb) {
+    board_.visit_rows_cols_outward(coord, [&](Coord seen, CellState) {
+      CellState const seen_cell = get_cell(seen);
+      if (is_illuminable(seen_cell)) {
+        ++preview.num_lit;
+        if (is_empty(seen_cell)) {
+          filled.set(flat_idx(seen));
+        }
+      }
+      else if (is_bulb(seen_cell)) {
+        preview.decision_type = DecisionType::BULBS_SEE_EACH_OTHER;
+        preview.ref_location  = coord;
+      }
+    });
+  }
+
+  // Then recheck the walls next to the cells that change, as the move
+  // would leave them.
+  model::BitPlane checked(num_cells);
+  int             first_broken = num_cells;
+  DecisionType    first_broken_type{};
+  auto const      check_wall = [&](Coord wall_coord, CellState wall_cell) {
+    int const deps = model::num_wall_deps(wall_cell);
+    int const idx  = flat_idx(wall_coord);
+    if (deps == 0 || checked.test(idx)) {
+      return;
+    }
+    checked.set(idx);
+
+    int const bulbs   = num_adjacent_bulbs(wall_coord);
+    int const empties = num_adjacent_empties(wall_coord);
+    int       bulbs_after   = bulbs;
+    int       empties_after = empties;
+    board_.visit_adjacent(wall_coord, [&](Coord adj_coord, CellState) {
+      bulbs_after += adds_bulb && adj_coord == coord;
+      empties_after -= filled.test(flat_idx(adj_coord));
+    });
+
+    bool const was_broken = bulbs > deps || deps - bulbs > empties;
+    if (bulbs_after == deps && bulbs < deps) {
+      preview.satisfied_walls.set(idx);
+    }
+    else if (not was_broken && (bulbs_after > deps ||
+                                deps - bulbs_after > empties_after)) {
+      preview.broken_walls.set(idx);
+      if (idx < first_broken) {
+        first_broken      = idx;
+        first_broken_type = bulbs_after > deps
+                                ? DecisionType::WALL_HAS_TOO_MANY_BULBS
+                                : DecisionType::WALL_CANNOT_BE_SATISFIED;
+      }
+    }
+  };
+  board_.visit_adjacent(coord, check_wall);
+  board_.visit_plane(filled, [&](Coord filled_coord, CellState) {
+    board_.visit_adjacent(filled_coord, check_wall);
+  });
+
+  if (not preview.has_error() && first_broken < num_cells) {
+    preview.decision_type = first_broken_type;
+    preview.ref_location =
+        model::coord_of(first_broken, model::DynamicWidth{width()});
+  }
+  return preview;
+}
+
 std::ostream &
 operator<<(std::ostream & os, PositionBoard const & pos_board) {
   fmt::print(os, "{}", pos_board);
@@ -6,10 +6,19 @@
 #include "Coord.hpp"
 #include "DecisionType.hpp"
 #include "Direction.hpp"
+#include "SegmentIndex.hpp"
 #include "SingleMove.hpp"
+#include "SmallBuffer.hpp"
+#include <algorithm>
+#include <cassert>
+#include <compare>
+#include <cstdint>
 #include <fmt/core.h>
 #include <fmt/ostream.h>
 #include <iosfwd>
+#include <memory>
+#include <span>
+#include <tuple>
 #include <vector>
 
 namespace solver {
@@ -18,8 +27,9 @@ namespace solver {
 // applies bulbs and marks, and illuminates the cells that bulbs illuminate. It
 // also tracks the validity of the move, the number of cells needing
 // illumination, and the number of walls still having unsatisfied deps.
-// If it detects an error, it tries to record why in the decision type,
-// referring to the ref_location on the board.
+// It keeps the set of rules the position currently breaks, adding and
+// clearing them as cells change. The most recent one is reported as the
+// decision type, referring to the ref_location on the board.
 
 // For convenience, the underlying board's rich visit interface is made
 // available here.
@@ -36,22 +46,58 @@ public:
   PositionBoard(model::BasicBoard const & board,
                 ResetPolicy = ResetPolicy::STOP_PLAYING_MOVES_ON_ERROR);
 
-  // Returns bool indicating request was successful.
+  // Returns bool indicating request was successful. Walls can be added over
+  // empty or illuminated cells, or replace another wall to change its deps.
+  // All of them work with errors on the board, which they add or clear.
   bool add_bulb(Coord);
   bool add_mark(Coord);
-  bool add_wall(Coord, CellState); // TODO
-  bool remove_bulb(Coord);         // TODO
-  bool remove_mark(Coord);         // TODO
-  bool remove_wall(Coord);         // TODO
+  bool add_wall(Coord, CellState);
+  bool remove_bulb(Coord);
+  bool remove_mark(Coord);
+  bool remove_wall(Coord);
   bool apply_move(model::SingleMove const &);
 
+  // Plays the moves as if one at a time, stopping after the first that leaves
+  // the position with an error or solved, and returns how many were played.
+  // When they only add bulbs and marks, they are placed together, and then
+  // their light is cast and the walls they affect checked once. If that
+  // results in an error, the moves are replayed one at a time instead, so
+  // the error reported is the one the first contradicting move makes.
+  std::size_t apply_moves(std::span<model::SingleMove const>);
+
+  // What adding a bulb or mark would do, found without playing it. Only the
+  // rules the board checks itself are considered, as when playing the move.
+  struct MovePreview {
+    // whether the move would be played, rather than refused
+    bool accepted = false;
+
+    // the cells needing illumination that a bulb would light (not counting
+    // its own cell)
+    int num_lit = 0;
+
+    // walls that would get their last bulb, and walls that would newly
+    // break a rule
+    model::BitPlane satisfied_walls;
+    model::BitPlane broken_walls;
+
+    // A rule the move would newly break: bulbs seeing each other, else the
+    // first broken wall in row-major order. NONE if there is none.
+    DecisionType    decision_type = DecisionType::NONE;
+    model::OptCoord ref_location;
+
+    bool has_error() const;
+  };
+
+  // Any other move is previewed as not accepted.
+  MovePreview preview(model::SingleMove const &) const;
+
   // Some set-cell calls can cause the underlying board to get out of sync with
-  // the position board error model, illumination, etc. Normally it will not
-  // reevaluate for moves that are easy to handle (add bulb, add mark, etc.,
-  // since that's supported), but for adding walls, or removing them, or
-  // changing wall deps, etc., the board should be fully reevaluated. However,
-  // if a cluster of changes will happen, we might want to not update until the
-  // last change, for efficiency and to make the whole group more "atomic".
+  // the position board error model, illumination, etc. Any change between
+  // empty, bulb, mark and wall cells is applied incrementally, touching only
+  // the rows, columns and neighbors it affects. Other changes fully reevaluate
+  // the board. However, if a cluster of changes will happen, we might want to
+  // not update until the last change, for efficiency and to make the whole
+  // group more "atomic".
   enum class SetCellPolicy {
     FORCE_REEVALUATE_BOARD,
     NO_REEVALUATE_BOARD,
@@ -67,13 +113,62 @@ public:
   void reevaluate_board_state(
       ResetPolicy = ResetPolicy::STOP_PLAYING_MOVES_ON_ERROR);
 
+  // Normally the light of a bulb is written into the empty cells it reaches
+  // as it's cast. Deferring it leaves them empty in the underlying board, lit
+  // only by their light counts, until materialize() writes it. get_cell and
+  // the counts report them as lit all along, so moves played only to ask
+  // about the counts and errors (as when speculating) skip most of the cell
+  // writes. board(), the visitors, hash() and comparisons see the cells as
+  // they are stored, so materialize() before rendering, printing, hashing or
+  // comparing a deferring position. (Reading never writes, so a const
+  // position can be read from several threads.)
+  enum class IllumPolicy { WRITE_WHEN_LIT, DEFER_UNTIL_MATERIALIZED };
+  void        set_illum_policy(IllumPolicy);
+  IllumPolicy illum_policy() const;
+
+  // writes ILLUM into the lit cells left empty by DEFER_UNTIL_MATERIALIZED
+  void materialize();
+
+  // reset discards any checkpoints
   void reset(int height, int width);
   void reset(model::BasicBoard const & board,
              ResetPolicy = ResetPolicy::STOP_PLAYING_MOVES_ON_ERROR);
 
+  // checkpoint() marks the current position, and rollback() returns to the
+  // most recent mark and removes it. Checkpoints nest. While there is one,
+  // every change made through this class is logged, so trying out moves and
+  // undoing them costs as much as the cells they change, rather than copying
+  // the whole position. (Changes made through mut_board() are not logged.)
+  void checkpoint();
+  void rollback();
+  int  num_checkpoints() const;
+
+  // Take on the state of another position of the same dimensions. Unlike
+  // assignment, this is logged, so can be rolled back.
+  void set_position(PositionBoard const & other);
+
+  // A rule the position breaks. Walls and bulbs seeing each other are found
+  // by the board itself; other errors, such as a mark that cannot be
+  // illuminated, are found by the solver and added with set_has_error. Marks
+  // and board errors are cleared once they no longer hold; others, only by
+  // set_has_error(false).
+  struct Violation {
+    DecisionType    type;
+    model::OptCoord location;
+    model::OptCoord other; // for a bulb, the one it sees
+
+    auto operator<=>(Violation const &) const = default;
+  };
+
+  // oldest first. The last is reported as the decision type and ref location.
+  std::vector<Violation> const & violations() const;
+
   DecisionType    decision_type() const;
   model::OptCoord get_ref_location() const;
   bool            has_error() const;
+
+  // Setting an error adds it to the violations, and clearing the error
+  // removes them all.
   void set_has_error(bool, DecisionType, model::OptCoord = std::nullopt);
 
   bool is_solved() const;
@@ -90,7 +185,35 @@ public:
   model::BasicBoard const & board() const;
   model::BasicBoard &       mut_board();
 
-  auto operator<=>(PositionBoard const &) const = default;
+  // The light counts and neighbor tallies are derived from the cells, so are
+  // not compared.
+  bool operator==(PositionBoard const &) const;
+  auto operator<=>(PositionBoard const &) const;
+
+  // how many bulbs shine on the cell (0 for walls)
+  int light_count(Coord) const;
+
+  // by flat index, the cells with a nonzero light count
+  model::BitPlane const & lit_cells() const;
+
+  // The number of empty cells and bulbs next to a cell. They are kept up to
+  // date as cells change, so checking a wall doesn't visit its neighbors.
+  int num_adjacent_empties(Coord) const;
+  int num_adjacent_bulbs(Coord) const;
+
+  // Once tracked, the number of empty cells in each row and column segment
+  // of the walls is kept up to date as cells change too, by segment number
+  // in segment_index(). Adding or removing a wall, or resetting, stops it;
+  // taking on a position with the same walls keeps it.
+  void                 track_segment_empties();
+  bool                 tracks_segment_empties() const;
+  SegmentIndex const & segment_index() const;
+  int                  num_row_segment_empties(int segment) const;
+  int                  num_col_segment_empties(int segment) const;
+
+  // the rest of the position is derived from the cells, so this is just the
+  // hash of the underlying board.
+  std::uint64_t hash() const;
 
   bool visit_board(model::CellVisitor auto && visitor) const;
   bool
@@ -112,6 +235,9 @@ public:
   bool visit_col_below(Coord                            coord,
                        model::OptDirCellVisitor auto && visitor) const;
 
+  bool visit_row_segments(model::SegmentVisitor auto && visitor) const;
+  bool visit_col_segments(model::SegmentVisitor auto && visitor) const;
+
   void visit_perpendicular(Coord                            coord,
                            model::Direction                 dir,
                            model::OptDirCellVisitor auto && visitor) const;
@@ -124,8 +250,68 @@ public:
 private:
   friend std::ostream & operator<<(std::ostream &, PositionBoard const &);
 
-  void remove_illum_in_direction_from(model::Coord     start_at,
-                                      model::Direction dir);
+  int flat_idx(Coord) const;
+
+  // removes the most recent checkpoint, keeping the changes made since
+  void drop_checkpoint();
+
+  // all cell and light count changes go through these, to be logged
+  void save_cell(int idx);
+  bool write_cell(Coord, CellState);
+
+  // sets a cell without logging it, updating its neighbors' tallies
+  bool store_cell(Coord, CellState);
+  void adjust_neighbor_tallies(Coord, int empties, int bulbs);
+  void adjust_segment_empties(int idx, int empties);
+
+  // counts the empty cells of each segment from scratch
+  void count_segment_empties();
+
+  // Sets the light count of a non-wall cell without logging it. An empty cell
+  // stops counting as empty to its neighbors once lit, whether or not ILLUM
+  // has been written into it.
+  void set_light_count(Coord, int count);
+
+  // whether materialize() has light to write
+  bool has_deferred_light() const;
+
+  // Adds the light of the bulb at bulb_coord to the cells in the given
+  // directions from start_at, up to the next wall, updating the walls they
+  // neighbor.
+  void shine_rays(Coord bulb_coord, Coord start_at, model::Direction);
+
+  // The light-casting part of shine_rays, which passes each cell it lights,
+  // and the wall that stops it, to on_reached(dir, coord, orig_cell).
+  void cast_light(Coord            bulb_coord,
+                  Coord            start_at,
+                  model::Direction directions,
+                  auto &&          on_reached);
+
+  // Whether apply_moves can place the moves together: they only add bulbs
+  // and marks, each to a different cell, and no bulbs over marks, to an
+  // unfinished position that is up to date.
+  bool can_place_together(std::span<model::SingleMove const>) const;
+
+  // Adds the bulbs and marks of apply_moves together, and returns the index of
+  // the last one that would be accepted if they were played one at a time, or
+  // -1 if none would be.
+  int place_moves(std::span<model::SingleMove const>);
+
+  // Takes away the light of one bulb from the cells in the given directions
+  // from start_at, up to the next wall, and un-illuminates those left unlit.
+  void dim_rays(Coord start_at, model::Direction directions);
+
+  // Makes an incremental change for set_cell.
+  bool change_cell(Coord, CellState);
+
+  // Adds a violation as the most recent, or makes it the most recent if it is
+  // already there. Bulbs seeing each other are only listed once per pair.
+  void add_violation(Violation);
+
+  // Removes the violations found by the board, and the unlightable marks,
+  // that no longer hold. Called after changes that can fix errors.
+  void clear_fixed_violations();
+  bool holds(Violation const &) const;
 
   // returns indication if wall at wall_coord "is satisfied"
   bool update_wall(Coord     wall_coord,
@@ -133,104 +319,337 @@ private:
                    CellState play_cell,
                    bool      is_adjacent_to_play);
 
-  bool              has_error_                      = false;
-  int               num_cells_needing_illumination_ = 0;
-  int               num_walls_with_deps_            = 0;
-  DecisionType      decision_type_                  = DecisionType::NONE;
-  model::OptCoord   ref_location_;
+  std::vector<Violation> violations_;
+  int                    num_walls_with_deps_ = 0;
+  IllumPolicy            illum_policy_        = IllumPolicy::WRITE_WHEN_LIT;
+
   model::BasicBoard board_{};
+
+  // set when the board was changed without updating the rest of the position,
+  // which then must be fully reevaluated rather than updated incrementally.
+  bool needs_reevaluation_ = false;
+
+  // by flat index, the number of bulbs whose light reaches each cell, so a
+  // bulb can be removed by updating the cells it lit.
+  static int constexpr INLINE_CELLS =
+      model::BasicBoard::INLINE_GRID_EDGE * model::BasicBoard::INLINE_GRID_EDGE;
+  model::SmallBuffer<std::uint16_t, INLINE_CELLS> light_counts_;
+
+  // the cells with a nonzero light count
+  model::BitPlane lit_;
+
+  // what is next to each cell. Like the board's cells, these have a border
+  // around them so a cell's neighbors can be updated without bounds checks.
+  struct NeighborTally {
+    std::uint8_t empties;
+    std::uint8_t bulbs;
+  };
+  static int constexpr INLINE_PADDED_CELLS =
+      (model::BasicBoard::INLINE_GRID_EDGE + 2) *
+      (model::BasicBoard::INLINE_GRID_EDGE + 2);
+  model::SmallBuffer<NeighborTally, INLINE_PADDED_CELLS> tallies_;
+  int tally_idx(Coord) const;
+
+  // the segments of the walls, shared by copies, and the number of empty
+  // cells in each. Null unless tracking them.
+  std::shared_ptr<SegmentIndex const> segments_;
+  std::vector<int>                    row_segment_empties_;
+  std::vector<int>                    col_segment_empties_;
+
+  // the previous contents of cells changed since the first checkpoint
+  struct SavedCell {
+    int           idx;
+    CellState     cell;
+    std::uint16_t light_count;
+  };
+  struct Checkpoint {
+    std::size_t            trail_size;
+    std::vector<Violation> violations;
+    int                    num_walls_with_deps;
+    model::OptCoord        last_move_coord;
+    bool                   needs_reevaluation;
+
+    // the segments tracked, if any, which a wall change since would drop
+    std::shared_ptr<SegmentIndex const> segments;
+  };
+  std::vector<SavedCell>  trail_;
+  std::vector<Checkpoint> checkpoints_;
 };
 
+inline bool
+PositionBoard::operator==(PositionBoard const & other) const {
+  assert(not has_deferred_light() && not other.has_deferred_light());
+  return std::tie(violations_, num_walls_with_deps_, board()) ==
+         std::tie(other.violations_, other.num_walls_with_deps_, other.board());
+}
+
+inline auto
+PositionBoard::operator<=>(PositionBoard const & other) const {
+  assert(not has_deferred_light() && not other.has_deferred_light());
+  return std::tie(violations_, num_walls_with_deps_, board()) <=>
+         std::tie(other.violations_, other.num_walls_with_deps_, other.board());
+}
+
+inline int
+PositionBoard::flat_idx(Coord coord) const {
+  return coord.row_ * board_.width() + coord.col_;
+}
+
+inline int
+PositionBoard::light_count(Coord coord) const {
+  return light_counts_[flat_idx(coord)];
+}
+
+inline model::BitPlane const &
+PositionBoard::lit_cells() const {
+  return lit_;
+}
+
+inline int
+PositionBoard::tally_idx(Coord coord) const {
+  return (coord.row_ + 1) * (board_.width() + 2) + coord.col_ + 1;
+}
+
+inline int
+PositionBoard::num_adjacent_empties(Coord coord) const {
+  return tallies_[tally_idx(coord)].empties;
+}
+
+inline int
+PositionBoard::num_adjacent_bulbs(Coord coord) const {
+  return tallies_[tally_idx(coord)].bulbs;
+}
+
+inline bool
+PositionBoard::tracks_segment_empties() const {
+  return segments_ != nullptr;
+}
+
+inline SegmentIndex const &
+PositionBoard::segment_index() const {
+  assert(segments_);
+  return *segments_;
+}
+
+inline int
+PositionBoard::num_row_segment_empties(int segment) const {
+  return row_segment_empties_[segment];
+}
+
+inline int
+PositionBoard::num_col_segment_empties(int segment) const {
+  return col_segment_empties_[segment];
+}
+
+inline void
+PositionBoard::adjust_segment_empties(int idx, int empties) {
+  if (segments_) {
+    row_segment_empties_[segments_->row_segment_of[idx]] += empties;
+    col_segment_empties_[segments_->col_segment_of[idx]] += empties;
+  }
+}
+
+inline bool
+PositionBoard::MovePreview::has_error() const {
+  return decision_type != DecisionType::NONE;
+}
+
+inline int
+PositionBoard::num_checkpoints() const {
+  return static_cast<int>(checkpoints_.size());
+}
+
+inline void
+PositionBoard::save_cell(int idx) {
+  if (not checkpoints_.empty()) {
+    trail_.push_back(
+        {idx, board_.get_cell_flat_unchecked(idx), light_counts_[idx]});
+  }
+}
+
+inline bool
+PositionBoard::write_cell(Coord coord, CellState cell) {
+  if (not checkpoints_.empty() && coord.in_range(height(), width())) {
+    save_cell(flat_idx(coord));
+  }
+  return store_cell(coord, cell);
+}
+
+inline bool
+PositionBoard::store_cell(Coord coord, CellState cell) {
+  if (coord.in_range(height(), width())) {
+    // a lit cell is not empty, even if ILLUM is yet to be written into it
+    CellState const orig_cell = get_cell(coord);
+    bool const      is_lit    = lit_.test(flat_idx(coord));
+    int const empties = (model::is_empty(cell) && not is_lit) -
+                        model::is_empty(orig_cell);
+    int const bulbs   = model::is_bulb(cell) - model::is_bulb(orig_cell);
+    if (empties != 0 || bulbs != 0) {
+      adjust_neighbor_tallies(coord, empties, bulbs);
+      adjust_segment_empties(flat_idx(coord), empties);
+    }
+  }
+  return board_.set_cell(coord, cell);
+}
+
+inline void
+PositionBoard::set_light_count(Coord coord, int count) {
+  int const idx = flat_idx(coord);
+  if ((light_counts_[idx] > 0) != (count > 0)) {
+    if (count > 0) {
+      lit_.set(idx);
+    }
+    else {
+      lit_.reset(idx);
+    }
+    if (model::is_empty(board_.get_cell_flat_unchecked(idx))) {
+      adjust_neighbor_tallies(coord, count > 0 ? -1 : 1, 0);
+      adjust_segment_empties(idx, count > 0 ? -1 : 1);
+    }
+  }
+  light_counts_[idx] = count;
+}
+
 inline void
 PositionBoard::reset(int height, int width) {
-  has_error_                      = false;
-  num_cells_needing_illumination_ = height * width;
-  num_walls_with_deps_            = 0;
-  decision_type_                  = DecisionType::NONE;
-  ref_location_                   = std::nullopt;
+  violations_.clear();
+  num_walls_with_deps_ = 0;
+  needs_reevaluation_  = false;
   board_.reset(height, width);
+  light_counts_.resize(height * width);
+  std::fill_n(light_counts_.data(), height * width, 0);
+  lit_.resize(height * width);
+
+  // every cell starts empty
+  int const num_padded = (height + 2) * (width + 2);
+  tallies_.resize(num_padded);
+  std::fill_n(tallies_.data(), num_padded, NeighborTally{4, 0});
+  for (int row = 0; row < height; ++row) {
+    tallies_[tally_idx({row, 0})].empties--;
+    tallies_[tally_idx({row, width - 1})].empties--;
+  }
+  for (int col = 0; col < width; ++col) {
+    tallies_[tally_idx({0, col})].empties--;
+    tallies_[tally_idx({height - 1, col})].empties--;
+  }
+  segments_.reset();
+  trail_.clear();
+  checkpoints_.clear();
+}
+
+inline std::uint64_t
+PositionBoard::hash() const {
+  assert(not has_deferred_light());
+  return board().hash();
+}
+
+inline PositionBoard::IllumPolicy
+PositionBoard::illum_policy() const {
+  return illum_policy_;
 }
 
 inline model::CellState
 PositionBoard::get_cell(model::Coord coord) const {
-  return board_.get_cell(coord);
+  CellState const cell = board_.get_cell(coord);
+  return model::is_empty(cell) && lit_.test(flat_idx(coord)) ? CellState::ILLUM
+                                                             : cell;
 }
 
 inline std::optional<model::CellState>
 PositionBoard::get_opt_cell(model::Coord coord) const {
-  return board_.get_opt_cell(coord);
+  if (coord.in_range(height(), width())) {
+    return get_cell(coord);
+  }
+  return std::nullopt;
 }
 
 inline bool
 PositionBoard::visit_board(model::CellVisitor auto && visitor) const {
-  return board_.visit_board(std::forward<decltype(visitor)>(visitor));
+  return board().visit_board(std::forward<decltype(visitor)>(visitor));
 }
 inline bool
 PositionBoard::visit_board_if(
     model::CellVisitor auto &&        visitor,
     model::CellVisitPredicate auto && should_visit_pred) const {
-  return board_.visit_board_if(
+  return board().visit_board_if(
       std::forward<decltype(visitor)>(visitor),
       std::forward<decltype(should_visit_pred)>(should_visit_pred));
 }
 inline bool
 PositionBoard::visit_adjacent(Coord                            coord,
                               model::OptDirCellVisitor auto && visitor) const {
-  return board_.visit_adjacent(coord, std::forward<decltype(visitor)>(visitor));
+  return board().visit_adjacent(coord,
+                                std::forward<decltype(visitor)>(visitor));
 }
 inline bool
 PositionBoard::visit_adj_flank(model::Coord                     coord,
                                model::Direction                 dir,
                                model::OptDirCellVisitor auto && visitor) const {
-  return board_.visit_adj_flank(
+  return board().visit_adj_flank(
       coord, dir, std::forward<decltype(visitor)>(visitor));
 }
 
 inline bool
 PositionBoard::visit_empty(model::CellVisitor auto && visitor) const {
-  return board_.visit_empty(std::forward<decltype(visitor)>(visitor));
+  return board().visit_empty(std::forward<decltype(visitor)>(visitor));
 }
 inline bool
 PositionBoard::visit_row_left_of(
     Coord coord, model::OptDirCellVisitor auto && visitor) const {
-  return board_.visit_row_left_of(coord,
-                                  std::forward<decltype(visitor)>(visitor));
+  return board().visit_row_left_of(coord,
+                                   std::forward<decltype(visitor)>(visitor));
 }
 inline bool
 PositionBoard::visit_row_right_of(
     Coord coord, model::OptDirCellVisitor auto && visitor) const {
-  return board_.visit_row_right_of(coord,
-                                   std::forward<decltype(visitor)>(visitor));
+  return board().visit_row_right_of(coord,
+                                    std::forward<decltype(visitor)>(visitor));
 }
 inline bool
 PositionBoard::visit_col_above(Coord                            coord,
                                model::OptDirCellVisitor auto && visitor) const {
-  return board_.visit_col_above(std::forward<decltype(visitor)>(visitor));
+  return board().visit_col_above(std::forward<decltype(visitor)>(visitor));
 }
 inline bool
 PositionBoard::visit_col_below(Coord                            coord,
                                model::OptDirCellVisitor auto && visitor) const {
-  return board_.visit_col_below(coord,
-                                std::forward<decltype(visitor)>(visitor));
+  return board().visit_col_below(coord,
+                                 std::forward<decltype(visitor)>(visitor));
+}
+inline bool
+PositionBoard::visit_row_segments(model::SegmentVisitor auto && visitor) const {
+  return board().visit_row_segments(std::forward<decltype(visitor)>(visitor));
+}
+inline bool
+PositionBoard::visit_col_segments(model::SegmentVisitor auto && visitor) const {
+  return board().visit_col_segments(std::forward<decltype(visitor)>(visitor));
 }
 inline void
 PositionBoard::visit_perpendicular(
     Coord                            coord,
     model::Direction                 dir,
     model::OptDirCellVisitor auto && visitor) const {
-  return board_.visit_perpendicular(
+  return board().visit_perpendicular(
       coord, dir, std::forward<decltype(visitor)>(visitor));
 }
 inline void
 PositionBoard::visit_rows_cols_outward(model::Coord                     coord,
                                        model::OptDirCellVisitor auto && visitor,
                                        model::Direction directions) const {
-  return board_.visit_rows_cols_outward(
+  return board().visit_rows_cols_outward(
       coord, std::forward<decltype(visitor)>(visitor), directions);
 }
 
 } // namespace solver
 
+template <>
+struct std::hash<::solver::PositionBoard> {
+  size_t
+  operator()(::solver::PositionBoard const & board) const {
+    return board.hash();
+  }
+};
+
 template <>
 struct fmt::formatter<::solver::PositionBoard> {
   template <typename ParseContext>
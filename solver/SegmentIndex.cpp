@@ -0,0 +1,36 @@
+#include "SegmentIndex.hpp"
+#include "BasicBoard.hpp"
+#include "CellState.hpp"
+#include "Coord.hpp"
+#include <span>
+
+namespace solver {
+
+using model::CellState;
+using model::Coord;
+
+SegmentIndex::SegmentIndex(model::BasicBoard const & board)
+    : walls{board.plane(model::CellPlane::WALL)} {
+  int const height = board.height();
+  int const width  = board.width();
+  row_segment_of.assign(height * width, -1);
+  col_segment_of.assign(height * width, -1);
+
+  auto add_segments = [&board](std::vector<Segment> & segments,
+                               std::vector<int> &     segment_of,
+                               int                    idx_step) {
+    return [&, idx_step](Coord start, std::span<CellState const> cells) {
+      int const segment = static_cast<int>(segments.size());
+      segments.push_back(Segment{start, static_cast<int>(cells.size())});
+      for (int i = 0, idx = start.row_ * board.width() + start.col_;
+           i < static_cast<int>(cells.size());
+           ++i, idx += idx_step) {
+        segment_of[idx] = segment;
+      }
+    };
+  };
+  board.visit_row_segments(add_segments(row_segments, row_segment_of, 1));
+  board.visit_col_segments(add_segments(col_segments, col_segment_of, width));
+}
+
+} // namespace solver
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "BasicBoard.hpp"
+#include "BitPlane.hpp"
+#include "Coord.hpp"
+#include <vector>
+
+namespace solver {
+
+// A maximal run of non-wall cells along a row or column.
+struct Segment {
+  model::Coord start{};
+  int          length = 0;
+};
+
+// Every row and column segment of a wall layout, and the segments each cell
+// belongs to. Light travels exactly along a segment, so the cells visible
+// from a cell are the cells of its two segments. Walls do not change while
+// solving, so this is built once per layout rather than once per position.
+struct SegmentIndex {
+  SegmentIndex() = default;
+  explicit SegmentIndex(model::BasicBoard const & board);
+
+  // the wall layout this index describes
+  model::BitPlane walls;
+
+  std::vector<Segment> row_segments;
+  std::vector<Segment> col_segments;
+
+  // by flat index; -1 for walls
+  std::vector<int> row_segment_of;
+  std::vector<int> col_segment_of;
+};
+
+} // namespace solver
@@ -2,6 +2,7 @@
 
 #include "AnnotatedMove.hpp"
 #include "BasicBoard.hpp"
+#include "ContextCache.hpp"
 #include "Coord.hpp"
 #include "DecisionType.hpp"
 #include "PositionBoard.hpp"
@@ -12,7 +13,6 @@
 #include "utils/EnumUtils.hpp"
 #include <iostream>
 #include <optional>
-#include <queue>
 #include <stdexcept>
 #include <vector>
 
@@ -53,16 +53,37 @@ to_string(SolutionStatus status) {
 
 class Solution {
 public:
-  using OptBoard = std::optional<model::BasicBoard>;
+  using OptBoard     = std::optional<model::BasicBoard>;
+  using ContextCache = solver::ContextCache;
 
+  // The buffers for solving, including those of the board, are taken from
+  // the thread's ContextCachePool, and returned to it when done.
   Solution(PositionBoard const & board, OptBoard known_solution = std::nullopt)
-      : board_(board)
+      : context_cache_(ContextCachePool::acquire())
+      , board_(std::move(context_cache_.board))
       , known_solution_(known_solution)
       , board_analysis_(create_board_analysis(board.board())) {
+    board_.set_illum_policy(board.illum_policy());
+    board_.set_position(board);
+    board_.track_segment_empties();
+    clear_queue();
     auto const size = board.width() * board.height();
     context_cache_.contexts.reserve(size);
     context_cache_.active_context_idxs.reserve(size);
     context_cache_.contradicting_context_idxs.reserve(size);
+    for (AnnotatedMoves * moves :
+         {&context_cache_.forced_moves, &context_cache_.trivial_moves}) {
+      moves->clear(); // (left from the cache's last board)
+      moves->reserve_for(board.height(), board.width());
+    }
+  }
+
+  Solution(Solution &&)             = default;
+  Solution & operator=(Solution &&) = default;
+
+  ~Solution() {
+    context_cache_.board = std::move(board_);
+    ContextCachePool::release(std::move(context_cache_));
   }
 
   bool
@@ -78,7 +99,7 @@ public:
 
   void
   enqueue_move(AnnotatedMove next_move) {
-    next_moves_.push(next_move);
+    context_cache_.next_moves.push_back(next_move);
   }
 
   void
@@ -111,8 +132,8 @@ public:
 
   bool
   apply_enqueued_next() {
-    if (not next_moves_.empty()) {
-      auto & next = next_moves_.front();
+    if (not empty_queue()) {
+      auto & next = front();
       LOG_DEBUG("{} {} {} {}\n",
                 next.next_move,
                 next.reason,
@@ -121,7 +142,7 @@ public:
                     ? fmt::format("{}", *next.reference_location)
                     : "");
       auto const next_move = next.next_move;
-      next_moves_.pop();
+      pop();
       if (is_empty(board_.get_cell(next_move.coord_))) {
         board_.apply_move(next_move);
         if (is_solved()) {
@@ -138,7 +159,7 @@ public:
 
   bool
   apply_all_enqueued() {
-    bool result = not next_moves_.empty();
+    bool result = not empty_queue();
     do {
     } while (apply_enqueued_next());
     return result;
@@ -196,48 +217,44 @@ public:
     step_count_++;
   }
 
+  // The queue is the cache's next_moves, from next_move_idx_ on. It is
+  // emptied once all of it is played, so it stays no longer than one step's
+  // moves.
   bool
   empty_queue() const {
-    return next_moves_.empty();
+    return next_move_idx_ == context_cache_.next_moves.size();
   }
 
   void
   clear_queue() {
-    next_moves_ = {};
+    context_cache_.next_moves.clear();
+    next_move_idx_ = 0;
   }
 
-  auto const &
+  AnnotatedMove const &
   front() const {
-    return next_moves_.front();
+    return context_cache_.next_moves[next_move_idx_];
   }
 
   void
   pop() {
-    next_moves_.pop();
+    if (++next_move_idx_ == context_cache_.next_moves.size()) {
+      clear_queue();
+    }
   }
 
-  struct ContextCache {
-    using Indices     = std::vector<int>;
-    using IndicesIter = Indices::iterator;
-
-    std::vector<SpeculationContext> contexts;
-    Indices                         active_context_idxs;
-    Indices                         contradicting_context_idxs;
-    std::vector<AnnotatedMove>      forced_moves;
-  };
-
   ContextCache &
   get_context_cache() {
     return context_cache_;
   }
 
 private:
+  ContextCache                   context_cache_;
   PositionBoard                  board_;
   OptBoard                       known_solution_;
-  std::queue<AnnotatedMove>      next_moves_;
-  SolutionStatus                 status_     = SolutionStatus::INITIAL;
-  int                            step_count_ = 0;
-  ContextCache                   context_cache_;
+  std::size_t                    next_move_idx_ = 0;
+  SolutionStatus                 status_        = SolutionStatus::INITIAL;
+  int                            step_count_    = 0;
   std::unique_ptr<BoardAnalysis> board_analysis_;
 };
 } // namespace solver
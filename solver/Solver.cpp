@@ -46,13 +46,14 @@ Solution::ContextCache &
 add_speculation_context_for_move(Solution & solution, SingleMove move) {
 
   Solution::ContextCache & context_cache = solution.get_context_cache();
-  auto &                   context =
-      context_cache.contexts.emplace_back(0, solution.board(), move);
+  auto &                context = context_cache.contexts.emplace_back(0, move);
+  PositionBoard const & board   = solution.board();
 
-  context.board.apply_move(context.first_move);
+  // only whether the move breaks a rule is needed, so it isn't played
+  context.contradiction = board.preview(context.first_move).has_error();
 
   int const idx = context_cache.contexts.size() - 1;
-  if (context.board.has_error()) {
+  if (context.contradiction) {
     context_cache.contradicting_context_idxs.push_back(idx);
   }
   else {
@@ -93,71 +94,87 @@ remove_from_active(Solution::ContextCache::Indices &   active_context_idxs,
   }
 };
 
+// Plays out the forced moves following the first move of the context, one
+// round at a time, until it finds a contradiction, solves the board, or runs
+// out of forced moves. It's played on the solution's board, and rolled back.
+void
+play_out_speculation(Solution & solution, SpeculationContext & context) {
+  PositionBoard &           board  = solution.board();
+  AnnotatedMoves &          forced = solution.get_context_cache().forced_moves;
+  std::vector<SingleMove> & moves  = solution.get_context_cache().moves;
+
+  board.checkpoint();
+  board.apply_move(context.first_move);
+  for (context.depth = 1;; ++context.depth) {
+    forced.clear();
+    if (OptCoord unlightable_mark = find_trivial_moves(
+            board, solution.get_board_analysis(), forced)) {
+      context.contradiction = true;
+      context.decision_type = DecisionType::MARK_CANNOT_BE_ILLUMINATED;
+      context.ref_location  = *unlightable_mark;
+      break;
+    }
+
+    // no forced moves is a dead-end
+    if (forced.empty()) {
+      break;
+    }
+
+    // Apply all of this iteration's forced moves, up to the first that
+    // contradicts
+    moves.clear();
+    for (auto & move : forced) {
+      moves.push_back(move.next_move);
+    }
+    std::size_t const num_played = board.apply_moves(moves);
+    if (board.has_error()) {
+      AnnotatedMove const & move = forced[num_played - 1];
+      context.contradiction      = true;
+      context.decision_type      = move.reason;
+      context.ref_location       = move.reference_location;
+      break;
+    }
+    if (board.is_solved()) {
+      break;
+    }
+  }
+  board.rollback();
+}
+
 // PRE-REQUISITE: the solution cache is already initialized with the contexts
 // to speculate over.
 size_t
 speculate_over_cache(Solution & solution) {
-  Solution::ContextCache & cache = solution.get_context_cache();
-
-  auto & [contexts, active_, contradictions, forced] = cache;
-
-  // clang does not allow references to local bindings yet, (so "active_" above
-  // cannot be used in lambda capture)
-  auto & active = cache.active_context_idxs;
+  Solution::ContextCache & cache          = solution.get_context_cache();
+  auto &                   contexts       = cache.contexts;
+  auto &                   active         = cache.active_context_idxs;
+  auto &                   contradictions = cache.contradicting_context_idxs;
+
+  // Speculating only asks about the counts and errors, and rolls back, so
+  // the light it casts needn't be written into the cells.
+  PositionBoard &                 board  = solution.board();
+  PositionBoard::IllumPolicy const policy = board.illum_policy();
+  board.set_illum_policy(PositionBoard::IllumPolicy::DEFER_UNTIL_MATERIALIZED);
+  for (int idx : active) {
+    play_out_speculation(solution, contexts[idx]);
+  }
+  board.set_illum_policy(policy);
 
+  // Report the contradictions in the order they'd be found by applying one
+  // round of forced moves to every active context at a time, removing each
+  // from the active list as it stops. (The hints rely on this order.)
   std::size_t depth = 1;
-  //  apply one batch of forced moves to all boards until we learn something.
-  while (not active.empty()) {
+  for (int round = 1; not active.empty(); ++round) {
     depth++;
     for (auto iter = active.begin(); iter != active.end();) {
-      SpeculationContext & context = contexts[*iter];
-      forced.clear();
-      if (OptCoord unlightable_mark = find_trivial_moves(
-              context.board.board(), solution.get_board_analysis(), forced)) {
-        contradictions.push_back(*iter);
-        SpeculationContext & context = contexts[(*iter)];
-        context.decision_type        = DecisionType::MARK_CANNOT_BE_ILLUMINATED;
-        context.ref_location         = *unlightable_mark;
-        iter                         = remove_from_active(active, iter);
-        continue;
-      }
-
-      // ////////////////////////////////// REMOVE
-      // std::cout << "Speculating on: " << context.board.board() << "\n";
-      // for (auto & debug_item : forced) {
-      //   std::cout << "\tforced: " << debug_item << std::endl;
-      // }
-      ////////////////////////////////// END REMOVE
-
-      // no forced moves is a dead-end
-      if (forced.empty()) {
-        iter = remove_from_active(active, iter);
-        //        std::cout << "(DEAD END)\n";
-        continue;
-      }
-
-      // Apply all of this iteration's forced moves
-      bool inc_iter = true;
-      for (auto & move : forced) {
-        context.board.apply_move(move.next_move);
-        if (context.board.has_error()) {
-          //          std::cout << "(CONTRADICTION!)\n";
+      SpeculationContext const & context = contexts[*iter];
+      if (context.depth == round) {
+        if (context.contradiction) {
           contradictions.push_back(*iter);
-          SpeculationContext & context = contexts[(*iter)];
-          context.decision_type        = move.reason;
-          context.ref_location         = move.reference_location;
-          iter                         = remove_from_active(active, iter);
-          inc_iter                     = false;
-          break;
-        }
-        else if (context.board.is_solved()) {
-          iter = remove_from_active(active, iter);
-          //          std::cout << "(SOLVED)\n";
-          inc_iter = false;
-          break;
         }
+        iter = remove_from_active(active, iter);
       }
-      if (inc_iter) {
+      else {
         ++iter;
       }
     }
@@ -198,9 +215,10 @@ speculate(Solution & solution) {
 
 bool
 find_moves(Solution & solution) {
-  AnnotatedMoves moves;
+  AnnotatedMoves & moves = solution.get_context_cache().trivial_moves;
+  moves.clear();
   if (OptCoord invalid_mark_location = find_trivial_moves(
-          solution.board().board(), solution.get_board_analysis(), moves)) {
+          solution.board(), solution.get_board_analysis(), moves)) {
     LOG_DEBUG("Detected a mark that cannot be illuminated at {}\n",
               *invalid_mark_location);
     solution.set_status(SolutionStatus::IMPOSSIBLE);
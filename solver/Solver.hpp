@@ -36,4 +36,7 @@ bool check_solved(model::BasicBoard const & board);
 
 bool find_moves(Solution & solution);
 
+// plays every enqueued move, returning whether there were any
+bool play_moves(Solution & solution);
+
 } // namespace solver
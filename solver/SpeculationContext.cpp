@@ -8,7 +8,7 @@ operator<<(std::ostream & os, SpeculationContext const & sc) {
 
   os << "Context:[\n\tdepth:    " << sc.depth << "\n"
      << "solution: <solution>\n"
-     << "board:    " << sc.board << "first_move:  " << sc.first_move << "\n";
+     << "first_move:  " << sc.first_move << "\n";
   return os;
 }
 
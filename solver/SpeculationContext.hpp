@@ -11,25 +11,26 @@ namespace solver {
 
 // Speculation involves "trying" to place a bulb (or mark) in each empty cell,
 // and playing out the trivial/forced moves as a result to see if it causes a
-// contradiction.
+// contradiction. Each speculation is played out on the solution's board and
+// then rolled back, so a context only records its outcome.
 struct SpeculationContext;
 using SpeculationContexts = std::vector<SpeculationContext>;
 
 struct SpeculationContext {
-  SpeculationContext(int                   depth,
-                     PositionBoard const & board,
-                     model::SingleMove     first_move,
-                     DecisionType          decision_type = DecisionType::NONE,
-                     model::OptCoord       ref_location  = std::nullopt)
+  SpeculationContext(int               depth,
+                     model::SingleMove first_move,
+                     DecisionType      decision_type = DecisionType::NONE,
+                     model::OptCoord   ref_location  = std::nullopt)
       : depth{depth}
-      , board{board}
       , first_move{first_move}
       , decision_type{decision_type}
       , ref_location{ref_location} {}
 
+  // the round of forced moves after which it stopped: by contradiction, by
+  // solving the board, or by running out of forced moves.
   int               depth;
-  PositionBoard     board;
   model::SingleMove first_move;
+  bool              contradiction = false;
   DecisionType      decision_type;
   model::OptCoord   ref_location;
 };
@@ -6,6 +6,38 @@
 
 namespace solver::test {
 
+TEST(AnalysisBoardTest, pop_restores_cloned_position) {
+  model::ASCIILevelCreator creator;
+  creator("...");
+  creator(".3.");
+  creator("...");
+  model::BasicBoard board;
+  creator.finished(&board);
+  AnalysisBoard aboard(board);
+  EXPECT_EQ(1, aboard.stack_size());
+
+  aboard.add_mark({0, 0});
+  model::BasicBoard const marked = aboard.basic_board();
+
+  aboard.clone_position();
+  EXPECT_EQ(2, aboard.stack_size());
+  aboard.add_bulb({0, 1});
+  aboard.clone_position();
+  aboard = PositionBoard(board); // replacing the position is undoable too
+  EXPECT_EQ(board, aboard.basic_board());
+
+  aboard.pop();
+  EXPECT_EQ(model::CellState::BULB, aboard.get_cell({0, 1}));
+  aboard.pop();
+  EXPECT_EQ(1, aboard.stack_size());
+  EXPECT_EQ(marked, aboard.basic_board());
+  EXPECT_EQ(1, aboard.num_walls_with_deps());
+
+  // popping the last position does nothing
+  aboard.pop();
+  EXPECT_EQ(marked, aboard.basic_board());
+}
+
 TEST(AnalysisBoardTest, no_adjusting_stack_while_visiting) {
   model::ASCIILevelCreator creator;
   creator("...");
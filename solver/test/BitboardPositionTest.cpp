@@ -0,0 +1,121 @@
+#include "BitboardPosition.hpp"
+#include "ASCIILevelCreator.hpp"
+#include "BasicBoard.hpp"
+#include "DecisionType.hpp"
+#include "PositionBoard.hpp"
+#include "gtest/gtest.h"
+#include <random>
+
+namespace solver::test {
+
+using namespace model;
+
+TEST(BitboardPositionTest, lights_segments) {
+  ASCIILevelCreator creator;
+  creator("..0..");
+  creator(".....");
+  creator("..1..");
+  BasicBoard basic_board;
+  creator.finished(&basic_board);
+  BitboardPosition position(basic_board);
+  EXPECT_EQ(1, position.num_walls_with_deps());
+
+  EXPECT_TRUE(position.add_bulb({1, 2}));
+  EXPECT_EQ(CellState::ILLUM, position.get_cell({1, 0}));
+  EXPECT_EQ(CellState::ILLUM, position.get_cell({1, 4}));
+  EXPECT_EQ(CellState::EMPTY, position.get_cell({0, 0}));
+  EXPECT_EQ(0, position.num_walls_with_deps());
+  EXPECT_FALSE(position.has_error());
+
+  // lighting a mark takes it away, as in PositionBoard
+  EXPECT_TRUE(position.add_mark({0, 3}));
+  EXPECT_TRUE(position.add_bulb({0, 4}));
+  EXPECT_EQ(CellState::ILLUM, position.get_cell({0, 3}));
+  EXPECT_EQ(2, position.light_count({1, 4}));
+
+  EXPECT_TRUE(position.add_bulb({1, 0}));
+  EXPECT_TRUE(position.has_error());
+  EXPECT_EQ(DecisionType::BULBS_SEE_EACH_OTHER, position.decision_type());
+  EXPECT_EQ(Coord(1, 0), position.get_ref_location());
+
+  EXPECT_TRUE(position.remove_bulb({1, 0}));
+  EXPECT_FALSE(position.has_error());
+  EXPECT_EQ(CellState::ILLUM, position.get_cell({1, 0}));
+
+  EXPECT_TRUE(position.add_bulb({2, 1}));
+  EXPECT_EQ(DecisionType::WALL_HAS_TOO_MANY_BULBS, position.decision_type());
+  EXPECT_EQ(Coord(2, 2), position.get_ref_location());
+}
+
+namespace {
+// Plays the same random moves on both engines, on a board with random walls,
+// and expects the same cells and state after each.
+void
+expect_same_as_position_board(int height, int width, std::mt19937 & rng) {
+  CellState const walls[] = {CellState::WALL0,
+                             CellState::WALL1,
+                             CellState::WALL2,
+                             CellState::WALL3};
+  BasicBoard      basic_board(height, width);
+  for (int i = 0; i < height * width / 5; ++i) {
+    basic_board.set_cell({int(rng() % height), int(rng() % width)},
+                         walls[rng() % 4]);
+  }
+  PositionBoard    position(basic_board,
+                            PositionBoard::ResetPolicy::KEEP_ERRORS);
+  BitboardPosition bitboard(basic_board);
+
+  for (int i = 0; i < 60; ++i) {
+    // mostly adding, sometimes taking away what's there
+    Coord const     coord(rng() % height, rng() % width);
+    CellState const orig = position.get_cell(coord);
+    CellState const cell = rng() % 2 ? CellState::BULB : CellState::MARK;
+    SingleMove const move =
+        (is_bulb(orig) || is_mark(orig)) && rng() % 3 == 0
+            ? SingleMove{Action::REMOVE, orig, CellState::EMPTY, coord}
+            : SingleMove{Action::ADD, CellState::EMPTY, cell, coord};
+    position.apply_move(move);
+    bitboard.apply_move(move);
+
+    ASSERT_EQ(position.board(), bitboard.board()) << move;
+    ASSERT_EQ(position.has_error(), bitboard.has_error()) << move;
+    ASSERT_EQ(position.num_walls_with_deps(), bitboard.num_walls_with_deps());
+    ASSERT_EQ(position.is_solved(), bitboard.is_solved());
+    position.board().visit_board([&](Coord at, CellState) {
+      EXPECT_EQ(position.light_count(at), bitboard.light_count(at)) << at;
+    });
+    if (::testing::Test::HasFailure()) {
+      FAIL() << "after " << move << "\n" << position;
+    }
+  }
+
+  // and starting from a board with bulbs on it
+  BitboardPosition const rebuilt(bitboard.board());
+  EXPECT_EQ(bitboard.board(), rebuilt.board());
+  EXPECT_EQ(bitboard.has_error(), rebuilt.has_error());
+  EXPECT_EQ(bitboard.num_walls_with_deps(), rebuilt.num_walls_with_deps());
+}
+} // namespace
+
+TEST(BitboardPositionTest, matches_position_board) {
+  std::mt19937 rng(2468);
+  for (int game = 0; game < 100; ++game) {
+    expect_same_as_position_board(3 + game % 5, 3 + game % 6, rng);
+    if (HasFailure()) {
+      return;
+    }
+  }
+}
+
+// the segments of wide boards span several words of a plane
+TEST(BitboardPositionTest, matches_position_board_across_words) {
+  std::mt19937 rng(1357);
+  for (int game = 0; game < 4; ++game) {
+    expect_same_as_position_board(30 + game * 17, 60 + game * 31, rng);
+    if (HasFailure()) {
+      return;
+    }
+  }
+}
+
+} // namespace solver::test
@@ -1,9 +1,13 @@
 #include "PositionBoard.hpp"
 #include "ASCIILevelCreator.hpp"
 #include "BasicBoard.hpp"
+#include "BoardWidth.hpp"
 #include "DecisionType.hpp"
 #include "gmock/gmock-matchers.h"
 #include "gtest/gtest.h"
+#include <algorithm>
+#include <iterator>
+#include <random>
 
 namespace solver::test {
 
@@ -834,4 +838,821 @@ TEST(PositionBoardTest, set_cell4_make_batch_changes) {
   EXPECT_EQ(expected, board.board());
 }
 
+TEST(PositionBoardTest, hash_follows_position) {
+  ASCIILevelCreator creator;
+  creator("0...");
+  creator("....");
+  creator("..1.");
+  BasicBoard basic_board;
+  creator.finished(&basic_board);
+
+  PositionBoard board1(basic_board);
+  PositionBoard board2(basic_board);
+  EXPECT_EQ(board1.hash(), board2.hash());
+
+  // same position reached in a different order
+  board1.add_bulb({0, 1});
+  board1.add_mark({2, 0});
+  board2.add_mark({2, 0});
+  board2.add_bulb({0, 1});
+  EXPECT_EQ(board1, board2);
+  EXPECT_EQ(board1.hash(), board2.hash());
+  EXPECT_EQ(std::hash<PositionBoard>{}(board1),
+            std::hash<PositionBoard>{}(board2));
+
+  board2.add_bulb({2, 3});
+  EXPECT_NE(board1.hash(), board2.hash());
+}
+
+// the violations in a canonical order, and each pair of bulbs the same way
+std::vector<PositionBoard::Violation>
+sorted_violations(PositionBoard const & board) {
+  auto violations = board.violations();
+  for (auto & v : violations) {
+    if (v.type == DecisionType::BULBS_SEE_EACH_OTHER && v.other < v.location) {
+      std::swap(v.location, v.other);
+    }
+  }
+  std::sort(violations.begin(), violations.end());
+  return violations;
+}
+
+// A position updated incrementally should match one built from scratch,
+// though it may have found its errors in a different order.
+void
+expect_same_as_rebuilt(PositionBoard const & board) {
+  PositionBoard const rebuilt(board.board(),
+                              PositionBoard::ResetPolicy::KEEP_ERRORS);
+  EXPECT_EQ(rebuilt.board(), board.board());
+  EXPECT_EQ(rebuilt.num_walls_with_deps(), board.num_walls_with_deps());
+  EXPECT_EQ(sorted_violations(rebuilt), sorted_violations(board));
+  board.visit_board([&](Coord coord, CellState) {
+    EXPECT_EQ(rebuilt.light_count(coord), board.light_count(coord)) << coord;
+    EXPECT_EQ(rebuilt.num_adjacent_empties(coord),
+              board.num_adjacent_empties(coord))
+        << coord;
+    EXPECT_EQ(rebuilt.num_adjacent_bulbs(coord),
+              board.num_adjacent_bulbs(coord))
+        << coord;
+  });
+}
+
+TEST(PositionBoardTest, neighbor_tallies) {
+  ASCIILevelCreator creator;
+  creator("2..");
+  creator(".1.");
+  creator("...");
+  BasicBoard basic_board;
+  creator.finished(&basic_board);
+  PositionBoard board(basic_board);
+  EXPECT_EQ(2, board.num_adjacent_empties({0, 0}));
+  EXPECT_EQ(4, board.num_adjacent_empties({1, 1}));
+
+  board.add_bulb({0, 1});
+  EXPECT_EQ(1, board.num_adjacent_empties({0, 0}));
+  EXPECT_EQ(1, board.num_adjacent_bulbs({0, 0}));
+  EXPECT_EQ(3, board.num_adjacent_empties({1, 1}));
+  EXPECT_EQ(1, board.num_adjacent_bulbs({1, 1}));
+
+  board.checkpoint();
+  board.remove_bulb({0, 1});
+  EXPECT_EQ(0, board.num_adjacent_bulbs({1, 1}));
+  board.rollback();
+  EXPECT_EQ(1, board.num_adjacent_bulbs({1, 1}));
+  expect_same_as_rebuilt(board);
+}
+
+TEST(PositionBoardTest, light_counts) {
+  ASCIILevelCreator creator;
+  creator("..1.");
+  creator("....");
+  creator("..0.");
+  creator("....");
+  BasicBoard basic_board;
+  creator.finished(&basic_board);
+  PositionBoard board(basic_board);
+
+  board.add_bulb({0, 1});
+  board.add_bulb({1, 3});
+  EXPECT_EQ(0, board.num_walls_with_deps());
+  EXPECT_EQ(2, board.light_count({1, 1}));
+  EXPECT_EQ(1, board.light_count({0, 0}));
+  EXPECT_EQ(0, board.light_count({0, 2})); // wall
+  EXPECT_EQ(0, board.light_count({3, 0}));
+  expect_same_as_rebuilt(board);
+
+  // the crossing cell stays lit by the other bulb
+  ASSERT_TRUE(board.remove_bulb({0, 1}));
+  EXPECT_EQ(CellState::EMPTY, board.get_cell({0, 1}));
+  EXPECT_EQ(CellState::EMPTY, board.get_cell({0, 0}));
+  EXPECT_EQ(CellState::EMPTY, board.get_cell({3, 1}));
+  EXPECT_EQ(CellState::ILLUM, board.get_cell({1, 1}));
+  EXPECT_EQ(1, board.light_count({1, 1}));
+  EXPECT_EQ(1, board.num_walls_with_deps());
+  expect_same_as_rebuilt(board);
+
+  EXPECT_FALSE(board.remove_bulb({0, 1}));
+
+  ASSERT_TRUE(board.remove_bulb({1, 3}));
+  EXPECT_EQ(basic_board, board.board());
+  expect_same_as_rebuilt(board);
+}
+
+TEST(PositionBoardTest, remove_bulb_that_caused_error) {
+  ASCIILevelCreator creator;
+  creator("....");
+  creator(".0..");
+  BasicBoard basic_board;
+  creator.finished(&basic_board);
+  PositionBoard board(basic_board);
+
+  board.add_bulb({0, 0});
+  board.add_bulb({0, 3});
+  EXPECT_TRUE(board.has_error());
+  EXPECT_EQ(2, board.light_count({0, 1}));
+
+  ASSERT_TRUE(board.remove_bulb({0, 3}));
+  EXPECT_FALSE(board.has_error());
+  EXPECT_EQ(CellState::ILLUM, board.get_cell({0, 3}));
+  expect_same_as_rebuilt(board);
+}
+
+TEST(PositionBoardTest, add_wall_dims_blocked_light) {
+  ASCIILevelCreator creator;
+  creator("++...+");
+  creator("+*++++");
+  creator("++...+");
+  creator("*+++++");
+  creator("++...+");
+  creator("+++++*");
+  creator("++...+");
+  BasicBoard basic_board;
+  creator.finished(&basic_board);
+  PositionBoard board(basic_board);
+
+  EXPECT_EQ(2, board.light_count({3, 1}));
+  ASSERT_TRUE(board.add_wall({2, 1}, CellState::WALL0));
+  EXPECT_EQ(1, board.light_count({3, 1}));
+  EXPECT_EQ(0, board.light_count({2, 1}));
+  expect_same_as_rebuilt(board);
+}
+
+TEST(PositionBoardTest, checkpoint_rollback) {
+  ASCIILevelCreator creator;
+  creator("..1.");
+  creator("....");
+  creator("..0.");
+  creator("....");
+  BasicBoard basic_board;
+  creator.finished(&basic_board);
+  PositionBoard board(basic_board);
+  board.add_mark({3, 3});
+
+  PositionBoard const original = board;
+  board.checkpoint();
+  EXPECT_EQ(1, board.num_checkpoints());
+  board.add_bulb({0, 1});
+  board.add_mark({3, 0});
+  PositionBoard const after_first = board;
+
+  // nested, including an error, removals, walls, and a full reevaluation
+  board.checkpoint();
+  board.add_bulb({3, 1});
+  EXPECT_TRUE(board.has_error());
+  board.set_cell({3, 1}, CellState::EMPTY);
+  board.add_wall({1, 3}, CellState::WALL0);
+  board.set_cell({2, 0}, CellState::WALL1);
+  board.remove_bulb({0, 1});
+  EXPECT_NE(after_first, board);
+
+  board.rollback();
+  EXPECT_EQ(1, board.num_checkpoints());
+  EXPECT_EQ(after_first, board);
+  expect_same_as_rebuilt(board);
+
+  board.rollback();
+  EXPECT_EQ(0, board.num_checkpoints());
+  EXPECT_EQ(original, board);
+  EXPECT_EQ(original.hash(), board.hash());
+  expect_same_as_rebuilt(board);
+}
+
+TEST(PositionBoardTest, set_position_is_logged) {
+  PositionBoard board(3, 4);
+  PositionBoard other(3, 4);
+  other.add_bulb({1, 1});
+
+  board.checkpoint();
+  board.set_position(other);
+  EXPECT_EQ(other, board);
+  board.rollback();
+  EXPECT_EQ(PositionBoard(3, 4), board);
+
+  board.checkpoint();
+  EXPECT_THROW(board.set_position(PositionBoard(4, 3)), std::runtime_error);
+}
+
+TEST(PositionBoardTest, remove_wall_lets_light_through) {
+  ASCIILevelCreator creator;
+  creator("*.0..");
+  creator(".....");
+  creator("..2..");
+  creator(".....");
+  BasicBoard basic_board;
+  creator.finished(&basic_board);
+  PositionBoard board(basic_board);
+  board.add_bulb({0, 0});
+  board.add_bulb({2, 3});
+  EXPECT_EQ(1, board.num_walls_with_deps());
+
+  ASSERT_TRUE(board.remove_wall({0, 2}));
+  EXPECT_EQ(CellState::ILLUM, board.get_cell({0, 2}));
+  EXPECT_EQ(CellState::ILLUM, board.get_cell({0, 4}));
+  EXPECT_EQ(2, board.light_count({0, 3}));
+  EXPECT_FALSE(board.has_error());
+  expect_same_as_rebuilt(board);
+
+  // removing an unsatisfied wall
+  ASSERT_TRUE(board.remove_wall({2, 2}));
+  EXPECT_EQ(CellState::ILLUM, board.get_cell({2, 2}));
+  EXPECT_EQ(CellState::ILLUM, board.get_cell({2, 0}));
+  EXPECT_EQ(0, board.num_walls_with_deps());
+  EXPECT_FALSE(board.remove_wall({2, 2}));
+  expect_same_as_rebuilt(board);
+
+  // the light shines onto the other bulb
+  creator("*0*");
+  creator.finished(&basic_board);
+  board.reset(basic_board);
+  ASSERT_TRUE(board.remove_wall({0, 1}));
+  EXPECT_TRUE(board.has_error());
+  EXPECT_EQ(DecisionType::BULBS_SEE_EACH_OTHER, board.decision_type());
+}
+
+TEST(PositionBoardTest, change_wall_deps) {
+  ASCIILevelCreator creator;
+  creator("...");
+  creator(".1.");
+  creator("...");
+  BasicBoard basic_board;
+  creator.finished(&basic_board);
+  PositionBoard board(basic_board);
+  board.add_bulb({0, 1});
+  EXPECT_EQ(0, board.num_walls_with_deps());
+
+  EXPECT_TRUE(board.set_cell({1, 1}, CellState::WALL2));
+  EXPECT_EQ(1, board.num_walls_with_deps());
+  EXPECT_FALSE(board.has_error());
+  expect_same_as_rebuilt(board);
+
+  EXPECT_TRUE(board.set_cell({1, 1}, CellState::WALL0));
+  EXPECT_EQ(0, board.num_walls_with_deps());
+  expect_same_as_rebuilt(board);
+
+  board.add_mark({1, 0});
+  board.add_mark({1, 2});
+  EXPECT_TRUE(board.set_cell({1, 1}, CellState::WALL3));
+  EXPECT_TRUE(board.has_error());
+  EXPECT_EQ(DecisionType::WALL_CANNOT_BE_SATISFIED, board.decision_type());
+
+  // removing a mark can fix it
+  EXPECT_TRUE(board.remove_mark({1, 0}));
+  EXPECT_FALSE(board.has_error());
+  EXPECT_FALSE(board.remove_mark({1, 0}));
+  expect_same_as_rebuilt(board);
+}
+
+TEST(PositionBoardTest, incremental_set_cell_matches_rebuild) {
+  CellState const cells[] = {CellState::EMPTY,
+                             CellState::BULB,
+                             CellState::MARK,
+                             CellState::WALL0,
+                             CellState::WALL1,
+                             CellState::WALL2,
+                             CellState::WALL3,
+                             CellState::WALL4};
+  std::mt19937  rng(1234);
+  PositionBoard board(6, 7);
+  for (int i = 0; i < 2000; ++i) {
+    Coord     coord(rng() % 6, rng() % 7);
+    CellState cell = cells[rng() % std::size(cells)];
+    board.set_cell(
+        coord, cell, PositionBoard::SetCellPolicy::FORCE_REEVALUATE_BOARD);
+    expect_same_as_rebuilt(board);
+    if (HasFailure()) {
+      FAIL() << "after setting " << coord << " to " << cell << "\n" << board;
+    }
+  }
+}
+
+TEST(PositionBoardTest, stale_position_is_reevaluated) {
+  PositionBoard board(3, 3);
+  board.set_cell({0, 0},
+                 CellState::BULB,
+                 PositionBoard::SetCellPolicy::NO_REEVALUATE_BOARD);
+  board.set_cell({2, 2},
+                 CellState::WALL0,
+                 PositionBoard::SetCellPolicy::FORCE_REEVALUATE_BOARD);
+  EXPECT_EQ(CellState::ILLUM, board.get_cell({0, 2}));
+  expect_same_as_rebuilt(board);
+}
+
+TEST(PositionBoardTest, errors_are_cleared_one_at_a_time) {
+  ASCIILevelCreator creator;
+  creator("......");
+  creator(".1....");
+  creator("......");
+  creator("......");
+  BasicBoard basic_board;
+  creator.finished(&basic_board);
+  PositionBoard board(basic_board);
+
+  board.add_bulb({0, 1});
+  board.add_bulb({1, 0});
+  EXPECT_EQ(DecisionType::WALL_HAS_TOO_MANY_BULBS, board.decision_type());
+  board.add_bulb({3, 0});
+  board.add_bulb({3, 4});
+  ASSERT_EQ(3, board.violations().size());
+  EXPECT_EQ(DecisionType::BULBS_SEE_EACH_OTHER, board.decision_type());
+  EXPECT_EQ(Coord(3, 4), board.get_ref_location());
+
+  // a wall between the last two bulbs leaves the earlier errors
+  EXPECT_TRUE(board.set_cell({3, 2}, CellState::WALL0));
+  ASSERT_EQ(2, board.violations().size());
+  EXPECT_EQ(DecisionType::BULBS_SEE_EACH_OTHER, board.decision_type());
+  EXPECT_EQ(Coord(3, 0), board.get_ref_location());
+  expect_same_as_rebuilt(board);
+
+  EXPECT_TRUE(board.remove_bulb({3, 0}));
+  EXPECT_EQ(DecisionType::WALL_HAS_TOO_MANY_BULBS, board.decision_type());
+  EXPECT_EQ(Coord(1, 1), board.get_ref_location());
+  expect_same_as_rebuilt(board);
+
+  EXPECT_TRUE(board.remove_bulb({0, 1}));
+  EXPECT_FALSE(board.has_error());
+  EXPECT_EQ(DecisionType::NONE, board.decision_type());
+  expect_same_as_rebuilt(board);
+}
+
+TEST(PositionBoardTest, unlightable_mark_is_cleared_when_lit) {
+  ASCIILevelCreator creator;
+  creator(".0.");
+  creator("0..");
+  creator("...");
+  BasicBoard basic_board;
+  creator.finished(&basic_board);
+  PositionBoard board(basic_board);
+  board.add_mark({0, 0});
+
+  // as the solver would find it
+  board.set_has_error(
+      true, DecisionType::MARK_CANNOT_BE_ILLUMINATED, Coord{0, 0});
+  EXPECT_TRUE(board.has_error());
+
+  // unrelated changes leave it
+  board.add_bulb({2, 2});
+  EXPECT_EQ(DecisionType::MARK_CANNOT_BE_ILLUMINATED, board.decision_type());
+
+  EXPECT_TRUE(board.remove_wall({0, 1}));
+  EXPECT_FALSE(board.has_error());
+  EXPECT_EQ(CellState::MARK, board.get_cell({0, 0}));
+}
+
+TEST(PositionBoardTest, apply_moves_reports_first_contradiction) {
+  ASCIILevelCreator creator;
+  creator("1....");
+  creator(".....");
+  creator(".....");
+  BasicBoard basic_board;
+  creator.finished(&basic_board);
+  PositionBoard board(basic_board);
+
+  auto add = [](CellState cell, Coord coord) {
+    return SingleMove{Action::ADD, CellState::EMPTY, cell, coord};
+  };
+  std::vector<SingleMove> const moves{add(CellState::MARK, {2, 4}),
+                                      add(CellState::BULB, {0, 1}),
+                                      add(CellState::BULB, {1, 0}),
+                                      add(CellState::BULB, {2, 1})};
+
+  board.checkpoint();
+  EXPECT_EQ(2, board.apply_moves(std::span(moves).first(2)));
+  EXPECT_FALSE(board.has_error());
+  EXPECT_EQ(0, board.num_walls_with_deps());
+  board.rollback();
+
+  // the third move is the first to break a rule, and the last is not played
+  EXPECT_EQ(3, board.apply_moves(moves));
+  EXPECT_EQ(DecisionType::WALL_HAS_TOO_MANY_BULBS, board.decision_type());
+  EXPECT_EQ(Coord(0, 0), board.get_ref_location());
+  EXPECT_EQ(CellState::ILLUM, board.get_cell({2, 1}));
+  ASSERT_EQ(1, board.violations().size());
+  expect_same_as_rebuilt(board);
+}
+
+TEST(PositionBoardTest, apply_moves_matches_one_at_a_time) {
+  CellState const walls[] = {CellState::WALL0,
+                             CellState::WALL1,
+                             CellState::WALL2,
+                             CellState::WALL3};
+  std::mt19937 rng(4321);
+  for (int game = 0; game < 500; ++game) {
+    // small boards are often solved along the way
+    int const     height = 3 + game % 4;
+    int const     width  = 3 + game % 5;
+    PositionBoard start(height, width);
+    for (int i = 0; i < height * width / 5; ++i) {
+      start.add_wall({int(rng() % height), int(rng() % width)},
+                     walls[rng() % 4]);
+    }
+    if (start.has_error()) {
+      continue;
+    }
+    PositionBoard batched    = start;
+    PositionBoard one_by_one = start;
+
+    std::vector<SingleMove> moves;
+    for (int round = 0;
+         round < 50 && not batched.has_error() && not batched.is_solved();
+         ++round) {
+      moves.clear();
+      for (int i = 0, e = 1 + rng() % 6; i < e; ++i) {
+        Coord const     coord(rng() % height, rng() % width);
+        CellState const cell = rng() % 3 ? CellState::MARK : CellState::BULB;
+        moves.push_back({Action::ADD, CellState::EMPTY, cell, coord});
+      }
+
+      std::size_t num_played = 0;
+      for (auto const & move : moves) {
+        one_by_one.apply_move(move);
+        ++num_played;
+        if (one_by_one.has_error() || one_by_one.is_solved()) {
+          break;
+        }
+      }
+      ASSERT_EQ(num_played, batched.apply_moves(moves));
+      ASSERT_EQ(one_by_one, batched) << start;
+      ASSERT_EQ(one_by_one.violations(), batched.violations());
+      ASSERT_EQ(one_by_one.board().get_last_move_coord(),
+                batched.board().get_last_move_coord());
+      expect_same_as_rebuilt(batched);
+      if (HasFailure()) {
+        FAIL() << "after playing from\n" << start << "\nto\n" << batched;
+      }
+    }
+  }
+}
+
+TEST(PositionBoardTest, deferred_illum) {
+  ASCIILevelCreator creator;
+  creator("..1.");
+  creator("....");
+  BasicBoard basic_board;
+  creator.finished(&basic_board);
+  PositionBoard board(basic_board);
+  board.set_illum_policy(PositionBoard::IllumPolicy::DEFER_UNTIL_MATERIALIZED);
+
+  board.checkpoint();
+  ASSERT_TRUE(board.add_bulb({1, 2}));
+  EXPECT_EQ(CellState::ILLUM, board.get_cell({1, 0}));
+  EXPECT_EQ(3, board.num_cells_needing_illumination());
+  EXPECT_EQ(2, board.num_adjacent_empties({0, 2}));
+  EXPECT_FALSE(board.add_mark({1, 0}));
+  board.rollback();
+  EXPECT_EQ(CellState::EMPTY, board.get_cell({1, 0}));
+  EXPECT_EQ(7, board.num_cells_needing_illumination());
+
+  // reading the board leaves it as stored, until the light is written
+  ASSERT_TRUE(board.add_bulb({1, 2}));
+  EXPECT_EQ(CellState::EMPTY, board.board().get_cell({1, 0}));
+  board.materialize();
+  EXPECT_EQ(CellState::EMPTY, board.board().get_cell({0, 0}));
+  EXPECT_EQ(CellState::ILLUM, board.board().get_cell({1, 0}));
+  EXPECT_EQ(board, PositionBoard(board.board()));
+  expect_same_as_rebuilt(board);
+}
+
+TEST(PositionBoardTest, deferred_illum_matches_written_illum) {
+  CellState const walls[] = {CellState::WALL0,
+                             CellState::WALL1,
+                             CellState::WALL2,
+                             CellState::WALL3};
+  std::mt19937 rng(8642);
+  for (int game = 0; game < 200; ++game) {
+    int const     height = 3 + game % 5;
+    int const     width  = 3 + game % 6;
+    PositionBoard written(height, width);
+    for (int i = 0; i < height * width / 5; ++i) {
+      written.add_wall({int(rng() % height), int(rng() % width)},
+                       walls[rng() % 4]);
+    }
+    PositionBoard deferred = written;
+    deferred.set_illum_policy(
+        PositionBoard::IllumPolicy::DEFER_UNTIL_MATERIALIZED);
+
+    for (int i = 0; i < 60; ++i) {
+      Coord const     coord(rng() % height, rng() % width);
+      CellState const orig = written.get_cell(coord);
+      CellState const cell = rng() % 2 ? CellState::BULB : CellState::MARK;
+      switch (rng() % 8) {
+        case 0:
+          written.checkpoint();
+          deferred.checkpoint();
+          break;
+        case 1:
+          if (written.num_checkpoints() > 0) {
+            written.rollback();
+            deferred.rollback();
+          }
+          break;
+        case 2:
+          written.set_cell(coord, CellState::EMPTY);
+          deferred.set_cell(coord, CellState::EMPTY);
+          break;
+        default: {
+          SingleMove const move{Action::ADD, orig, cell, coord};
+          written.apply_move(move);
+          deferred.apply_move(move);
+        }
+      }
+
+      // everything but the underlying board reads the same before it's
+      // written
+      ASSERT_EQ(written.num_cells_needing_illumination(),
+                deferred.num_cells_needing_illumination());
+      ASSERT_EQ(written.is_solved(), deferred.is_solved());
+      ASSERT_EQ(written.violations(), deferred.violations());
+      ASSERT_EQ(written.num_walls_with_deps(), deferred.num_walls_with_deps());
+      for (int row = 0; row < height; ++row) {
+        for (int col = 0; col < width; ++col) {
+          Coord const at(row, col);
+          EXPECT_EQ(written.get_cell(at), deferred.get_cell(at)) << at;
+          EXPECT_EQ(written.num_adjacent_empties(at),
+                    deferred.num_adjacent_empties(at))
+              << at;
+        }
+      }
+      if (rng() % 4 == 0) {
+        deferred.materialize();
+        EXPECT_EQ(written.board(), deferred.board());
+      }
+      if (HasFailure()) {
+        FAIL() << "expected\n" << written << "\ngot\n" << deferred;
+      }
+    }
+    deferred.materialize();
+    expect_same_as_rebuilt(deferred);
+  }
+}
+
+// Plays random moves, some deferring their light, and checks the segment
+// counts against counting the empty cells of each segment.
+TEST(PositionBoardTest, tracks_segment_empties) {
+  CellState const walls[] = {CellState::WALL0,
+                             CellState::WALL1,
+                             CellState::WALL2,
+                             CellState::WALL3};
+  std::mt19937 rng(1357);
+  for (int game = 0; game < 200; ++game) {
+    int const     height = 3 + game % 5;
+    int const     width  = 3 + game % 6;
+    PositionBoard board(height, width);
+    for (int i = 0; i < height * width / 5; ++i) {
+      board.add_wall({int(rng() % height), int(rng() % width)},
+                     walls[rng() % 4]);
+    }
+    if (game % 2) {
+      board.set_illum_policy(
+          PositionBoard::IllumPolicy::DEFER_UNTIL_MATERIALIZED);
+    }
+    EXPECT_FALSE(board.tracks_segment_empties());
+    board.track_segment_empties();
+    ASSERT_TRUE(board.tracks_segment_empties());
+
+    SegmentIndex const & segments = board.segment_index();
+    for (int i = 0; i < 60; ++i) {
+      Coord const     coord(rng() % height, rng() % width);
+      CellState const orig = board.get_cell(coord);
+      CellState const cell = rng() % 2 ? CellState::BULB : CellState::MARK;
+      switch (rng() % 8) {
+        case 0:
+          board.checkpoint();
+          break;
+        case 1:
+          if (board.num_checkpoints() > 0) {
+            board.rollback();
+          }
+          break;
+        case 2:
+          if (not is_wall(orig)) {
+            board.set_cell(coord, CellState::EMPTY);
+          }
+          break;
+        default:
+          board.apply_move(SingleMove{Action::ADD, orig, cell, coord});
+      }
+
+      std::vector<int> row_empties(segments.row_segments.size());
+      std::vector<int> col_empties(segments.col_segments.size());
+      for (int idx = 0; idx < height * width; ++idx) {
+        if (is_empty(board.get_cell(coord_of(idx, DynamicWidth{width})))) {
+          ++row_empties[segments.row_segment_of[idx]];
+          ++col_empties[segments.col_segment_of[idx]];
+        }
+      }
+      for (int seg = 0; seg < std::ssize(row_empties); ++seg) {
+        ASSERT_EQ(row_empties[seg], board.num_row_segment_empties(seg))
+            << "row segment " << seg << "\n"
+            << board;
+      }
+      for (int seg = 0; seg < std::ssize(col_empties); ++seg) {
+        ASSERT_EQ(col_empties[seg], board.num_col_segment_empties(seg))
+            << "col segment " << seg << "\n"
+            << board;
+      }
+    }
+
+    // a position with the same walls keeps them tracked, but a new wall
+    // stops it
+    board.materialize();
+    PositionBoard const rebuilt(board.board(),
+                                PositionBoard::ResetPolicy::KEEP_ERRORS);
+    EXPECT_FALSE(rebuilt.tracks_segment_empties());
+    board.set_position(rebuilt);
+    EXPECT_TRUE(board.tracks_segment_empties());
+    bool const has_empty = board.board().plane(CellPlane::EMPTY).any();
+    board.visit_empty([&](Coord coord, CellState) {
+      board.add_wall(coord, CellState::WALL0);
+      return model::STOP_VISITING;
+    });
+    EXPECT_EQ(has_empty, not board.tracks_segment_empties());
+  }
+}
+
+TEST(PositionBoardTest, rollback_restores_segment_tracking) {
+  PositionBoard board(3, 4);
+  board.add_bulb({0, 0});
+  board.track_segment_empties();
+
+  auto expect_counted = [&] {
+    ASSERT_TRUE(board.tracks_segment_empties());
+    SegmentIndex const & segments = board.segment_index();
+    std::vector<int>     row_empties(segments.row_segments.size());
+    std::vector<int>     col_empties(segments.col_segments.size());
+    board.board().visit_board([&](Coord coord, CellState cell) {
+      int const idx = coord.row_ * board.width() + coord.col_;
+      if (is_empty(cell)) {
+        ++row_empties[segments.row_segment_of[idx]];
+        ++col_empties[segments.col_segment_of[idx]];
+      }
+    });
+    for (int seg = 0; seg < std::ssize(row_empties); ++seg) {
+      EXPECT_EQ(row_empties[seg], board.num_row_segment_empties(seg));
+    }
+    for (int seg = 0; seg < std::ssize(col_empties); ++seg) {
+      EXPECT_EQ(col_empties[seg], board.num_col_segment_empties(seg));
+    }
+  };
+
+  // a wall stops the tracking, but rolling it back starts it again
+  board.checkpoint();
+  board.add_wall({1, 2}, CellState::WALL0);
+  board.add_mark({2, 3});
+  EXPECT_FALSE(board.tracks_segment_empties());
+  board.rollback();
+  expect_counted();
+
+  // tracking started after a wall is kept, for the walls rolled back to
+  board.checkpoint();
+  board.add_wall({1, 2}, CellState::WALL0);
+  board.track_segment_empties();
+  board.add_mark({2, 3});
+  board.rollback();
+  expect_counted();
+  EXPECT_NE(-1, board.segment_index().row_segment_of[1 * 4 + 2]);
+}
+
+TEST(PositionBoardTest, preview) {
+  ASCIILevelCreator creator;
+  creator("..1.");
+  creator("....");
+  creator("*.2.");
+  BasicBoard basic_board;
+  creator.finished(&basic_board);
+  PositionBoard const board(basic_board);
+
+  auto const bulb_at = [](Coord coord) {
+    return SingleMove{Action::ADD, CellState::EMPTY, CellState::BULB, coord};
+  };
+  auto const mark_at = [](Coord coord) {
+    return SingleMove{Action::ADD, CellState::EMPTY, CellState::MARK, coord};
+  };
+
+  auto preview = board.preview(bulb_at({1, 2}));
+  EXPECT_TRUE(preview.accepted);
+  EXPECT_EQ(2, preview.num_lit);
+  EXPECT_FALSE(preview.has_error());
+  EXPECT_TRUE(preview.satisfied_walls.test(2));
+  EXPECT_EQ(1, preview.satisfied_walls.count());
+
+  // a lit cell takes neither a mark nor, without error, a bulb
+  EXPECT_FALSE(board.preview(mark_at({1, 0})).accepted);
+  preview = board.preview(bulb_at({1, 0}));
+  EXPECT_TRUE(preview.accepted);
+  EXPECT_EQ(DecisionType::BULBS_SEE_EACH_OTHER, preview.decision_type);
+  EXPECT_EQ(Coord(1, 0), preview.ref_location);
+
+  // the 2 would be left one empty neighbor short
+  preview = board.preview(mark_at({2, 3}));
+  EXPECT_EQ(0, preview.num_lit);
+  EXPECT_EQ(DecisionType::WALL_CANNOT_BE_SATISFIED, preview.decision_type);
+  EXPECT_EQ(Coord(2, 2), preview.ref_location);
+  EXPECT_EQ(board, PositionBoard(basic_board));
+}
+
+TEST(PositionBoardTest, preview_matches_playing) {
+  CellState const walls[] = {CellState::WALL0,
+                             CellState::WALL1,
+                             CellState::WALL2,
+                             CellState::WALL3};
+  std::mt19937 rng(1357);
+  for (int game = 0; game < 200; ++game) {
+    int const     height = 3 + game % 5;
+    int const     width  = 3 + game % 6;
+    PositionBoard board(height, width);
+    for (int i = 0; i < height * width / 5; ++i) {
+      board.add_wall({int(rng() % height), int(rng() % width)},
+                     walls[rng() % 4]);
+    }
+
+    for (int i = 0; i < 30 && not board.has_error(); ++i) {
+      // preview every move that could be made
+      board.visit_board([&](Coord coord, CellState) {
+        for (CellState cell : {CellState::BULB, CellState::MARK}) {
+          SingleMove const move{Action::ADD, CellState::EMPTY, cell, coord};
+          auto const       preview = board.preview(move);
+
+          PositionBoard played = board;
+          played.apply_move(move);
+          EXPECT_EQ(played.get_cell(coord) != board.get_cell(coord),
+                    preview.accepted)
+              << move;
+          EXPECT_EQ(played.has_error(), preview.has_error()) << move;
+          if (preview.has_error()) {
+            EXPECT_THAT(played.violations(),
+                        Contains(Field(&PositionBoard::Violation::location,
+                                       preview.ref_location)))
+                << move;
+          }
+          if (cell == CellState::BULB && preview.accepted) {
+            EXPECT_EQ(board.num_cells_needing_illumination() -
+                          played.num_cells_needing_illumination() -
+                          is_empty(board.get_cell(coord)),
+                      preview.num_lit)
+                << move;
+          }
+          board.visit_board([&](Coord at, CellState wall) {
+            int const  deps = num_wall_deps(wall);
+            int const  idx  = at.row_ * width + at.col_;
+            bool const satisfied =
+                deps > 0 && board.num_adjacent_bulbs(at) < deps &&
+                played.num_adjacent_bulbs(at) == deps;
+            bool const broken = std::ranges::any_of(
+                played.violations(), [&](auto const & violation) {
+                  return violation.location == at &&
+                         violation.type != DecisionType::BULBS_SEE_EACH_OTHER;
+                });
+            EXPECT_EQ(satisfied, preview.satisfied_walls.test(idx))
+                << move << at;
+            EXPECT_EQ(broken, preview.broken_walls.test(idx)) << move << at;
+          });
+        }
+      });
+      if (HasFailure()) {
+        FAIL() << board;
+      }
+
+      Coord const     coord(rng() % height, rng() % width);
+      CellState const cell = rng() % 3 ? CellState::MARK : CellState::BULB;
+      board.apply_move({Action::ADD, CellState::EMPTY, cell, coord});
+    }
+  }
+}
+
+TEST(PositionBoardTest, large_board) {
+  BasicBoard basic_board(200, 200);
+  basic_board.set_cell({150, 199}, CellState::WALL0);
+  PositionBoard board(basic_board);
+
+  ASSERT_TRUE(board.add_bulb({199, 199}));
+  EXPECT_EQ(CellState::ILLUM, board.get_cell({199, 0}));
+  EXPECT_EQ(CellState::ILLUM, board.get_cell({151, 199}));
+  EXPECT_EQ(CellState::EMPTY, board.get_cell({149, 199})); // behind the wall
+  EXPECT_EQ(CellState::EMPTY, board.get_cell({198, 198}));
+
+  PositionBoard copy = board;
+  EXPECT_EQ(board, copy);
+  EXPECT_EQ(board.hash(), copy.hash());
+}
+
 } // namespace solver::test
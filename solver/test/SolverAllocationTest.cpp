@@ -0,0 +1,108 @@
+#include "ASCIILevelCreator.hpp"
+#include "BasicBoard.hpp"
+#include "ContextCache.hpp"
+#include "Solution.hpp"
+#include "Solver.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <new>
+
+// Every allocation in the test binary is counted, so a test can check that
+// some code doesn't allocate. Replacing operator new affects the whole binary,
+// so this file is built as a test executable of its own.
+namespace {
+std::atomic<long> num_allocations{0};
+}
+
+void *
+operator new(std::size_t size) {
+  ++num_allocations;
+  if (void * ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void
+operator delete(void * ptr) noexcept {
+  std::free(ptr);
+}
+
+void
+operator delete(void * ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+
+namespace solver::test {
+using namespace ::testing;
+
+namespace {
+
+// a board that can't be solved without speculating
+model::BasicBoard
+make_board() {
+  model::ASCIILevelCreator creator;
+  creator("..0....2...0....");
+  creator("....00001....1..");
+  creator(".0.10..2..2.0..1");
+  creator("..2........0.0..");
+  creator("1..1.0.......02.");
+  creator("..2...0....2..0.");
+  creator("........1.2...0.");
+  creator(".0....1......100");
+  creator("100......2....2.");
+  creator(".1...0.0........");
+  creator(".0..0....2...2..");
+  creator(".01.......0.0..0");
+  creator("..0.0........0..");
+  creator("0..1.4..0..00.3.");
+  creator("..0....00000....");
+  creator("....1...0....1..");
+  model::BasicBoard board;
+  creator.finished(&board);
+  return board;
+}
+
+} // namespace
+
+TEST(SolverAllocationTest, solution_takes_cache_from_pool) {
+  model::BasicBoard const board = make_board();
+  solver::solve(board);
+  std::size_t const num_pooled = ContextCachePool::num_pooled();
+  ASSERT_GT(num_pooled, 0u);
+  {
+    Solution solution(board);
+    EXPECT_EQ(num_pooled - 1, ContextCachePool::num_pooled());
+
+    // a moved-from solution has nothing to give back
+    Solution moved = std::move(solution);
+  }
+  EXPECT_EQ(num_pooled, ContextCachePool::num_pooled());
+}
+
+TEST(SolverAllocationTest, solving_steps_do_not_allocate_after_warm_up) {
+  model::BasicBoard const board = make_board();
+
+  // the first solve on the thread grows the buffers that the next reuses
+  solver::solve(board);
+
+  Solution solution(board);
+  solution.set_status(SolutionStatus::PROGRESSING);
+
+  long const before    = num_allocations;
+  int        num_steps = 0;
+  do {
+    solution.add_step();
+    ++num_steps;
+    find_moves(solution);
+  } while (play_moves(solution) &&
+           solution.get_status() == SolutionStatus::PROGRESSING);
+  long const after = num_allocations;
+
+  EXPECT_TRUE(solution.is_solved());
+  EXPECT_GT(num_steps, 1);
+  EXPECT_EQ(0, after - before);
+}
+
+} // namespace solver::test
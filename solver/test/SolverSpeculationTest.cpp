@@ -1,5 +1,6 @@
 #include "ASCIILevelCreator.hpp"
 #include "BasicBoard.hpp"
+#include "PositionBoard.hpp"
 #include "Solution.hpp"
 #include "Solver.hpp"
 #include "utils/DebugLog.hpp"
@@ -406,4 +407,25 @@ TEST_F(SolverSpeculationTest, realistic_game11) {
   std::cout << solution.board().board() << std::endl;
 }
 
+TEST_F(SolverSpeculationTest, speculating_leaves_the_board_as_it_was) {
+  model::ASCIILevelCreator creator;
+  creator("....1...0.");
+  creator("..2...0..1");
+  creator("..0.......");
+  creator("01.......2");
+  creator(".....2.2..");
+  creator("...0.....0");
+
+  model::BasicBoard board;
+  creator.finished(&board);
+  Solution            solution(PositionBoard{board});
+  PositionBoard const before = solution.board();
+
+  // the speculation defers its light, which the rollbacks take back
+  EXPECT_GT(speculate(solution), 0u);
+  EXPECT_EQ(PositionBoard::IllumPolicy::WRITE_WHEN_LIT,
+            solution.board().illum_policy());
+  EXPECT_EQ(before, solution.board());
+}
+
 } // namespace solver::test
@@ -3,13 +3,18 @@
 #include "BasicBoard.hpp"
 #include "CellState.hpp"
 #include "Coord.hpp"
+#include "PositionBoard.hpp"
 #include "SingleMove.hpp"
 #include "Solution.hpp"
 #include "TestUtils.hpp"
 #include "trivial_moves.hpp"
 #include "gmock/gmock-matchers.h"
 #include "gtest/gtest.h"
+#include <algorithm>
+#include <memory>
+#include <random>
 #include <set>
+#include <thread>
 
 namespace solver::test {
 
@@ -102,6 +107,26 @@ TEST(TrivialMovesTest, find_around_walls_with_deps2) {
                           Coord{0, 1})));
 }
 
+TEST(TrivialMovesTest, find_around_walls_with_deps_from_position) {
+  model::ASCIILevelCreator creator;
+  creator("..2..");
+  creator("1...0");
+  creator(".*.3.");
+  creator(".....");
+  model::BasicBoard basic_board;
+  creator.finished(&basic_board);
+  std::unique_ptr board_analysis = create_board_analysis(basic_board);
+  PositionBoard   position(basic_board);
+
+  AnnotatedMoves from_board;
+  AnnotatedMoves from_position;
+  find_around_walls_with_deps(
+      position.board(), board_analysis.get(), from_board);
+  find_around_walls_with_deps(position, board_analysis.get(), from_position);
+  EXPECT_FALSE(from_board.empty());
+  EXPECT_EQ(from_board, from_position);
+}
+
 TEST(TrivialMovesTest, ambigus_cells_in_rows) {
   model::ASCIILevelCreator creator;
   creator("..0....");
@@ -235,4 +260,320 @@ TEST(TrivialMovesTest, ambigus_cells_in_cols) {
                                   MoveMotive::FOLLOWUP)));
 }
 
+TEST(TrivialMovesTest, segment_index) {
+  model::ASCIILevelCreator creator;
+  creator("..0");
+  creator(".1.");
+  creator("0..");
+  model::BasicBoard board;
+  creator.finished(&board);
+  std::unique_ptr board_analysis = create_board_analysis(board);
+
+  SegmentIndex const & segments = board_analysis->segments(board);
+  ASSERT_EQ(4, segments.row_segments.size());
+  ASSERT_EQ(4, segments.col_segments.size());
+
+  // row 1 is split by the wall in the middle
+  EXPECT_EQ(Coord(1, 0), segments.row_segments[1].start);
+  EXPECT_EQ(1, segments.row_segments[1].length);
+  EXPECT_EQ(Coord(1, 2), segments.row_segments[2].start);
+  EXPECT_EQ(2, segments.row_segments[3].length);
+
+  // cells in the same row segment share it, walls are in none
+  EXPECT_EQ(segments.row_segment_of[0], segments.row_segment_of[1]);
+  EXPECT_EQ(-1, segments.row_segment_of[2]);
+  EXPECT_EQ(-1, segments.col_segment_of[4]);
+  EXPECT_EQ(segments.col_segment_of[5], segments.col_segment_of[8]);
+
+  // changing the walls rebuilds the index
+  board.set_cell({1, 1}, CellState::EMPTY);
+  EXPECT_EQ(3, board_analysis->segments(board).row_segments.size());
+}
+
+TEST(TrivialMovesTest, annotated_moves_keep_one_move_per_cell) {
+  auto make_move = [](CellState cell, Coord coord) {
+    return AnnotatedMove{
+        SingleMove{Action::ADD, CellState::EMPTY, cell, coord},
+        DecisionType::WALL_SATISFIED_HAVING_OPEN_FACES,
+        MoveMotive::FORCED,
+        std::nullopt};
+  };
+  AnnotatedMoves moves;
+  EXPECT_FALSE(moves.has_move_at({0, 0}));
+  EXPECT_TRUE(moves.insert_if_unique(make_move(CellState::MARK, {0, 0})));
+  EXPECT_TRUE(moves.insert_if_unique(make_move(CellState::BULB, {2, 1})));
+  EXPECT_TRUE(moves.insert_if_unique(make_move(CellState::MARK, {254, 254})));
+
+  // the first move to a cell is kept
+  EXPECT_FALSE(moves.insert_if_unique(make_move(CellState::BULB, {0, 0})));
+  ASSERT_EQ(3, moves.size());
+  EXPECT_EQ(CellState::MARK, moves[0].next_move.to_);
+  EXPECT_TRUE(moves.has_move_at({2, 1}));
+  EXPECT_FALSE(moves.has_move_at({1, 2}));
+
+  moves.clear();
+  EXPECT_TRUE(moves.empty());
+  EXPECT_FALSE(moves.has_move_at({2, 1}));
+  EXPECT_TRUE(moves.insert_if_unique(make_move(CellState::BULB, {0, 0})));
+  EXPECT_THAT(moves, ElementsAre(make_move(CellState::BULB, {0, 0})));
+}
+
+TEST(TrivialMovesTest, annotated_moves_sized_for_board) {
+  auto make_move = [](Coord coord) {
+    return AnnotatedMove{
+        SingleMove{Action::ADD, CellState::EMPTY, CellState::MARK, coord},
+        DecisionType::WALL_SATISFIED_HAVING_OPEN_FACES,
+        MoveMotive::FORCED,
+        std::nullopt};
+  };
+  AnnotatedMoves moves(3, 4);
+  EXPECT_TRUE(moves.insert_if_unique(make_move({2, 3})));
+  EXPECT_TRUE(moves.insert_if_unique(make_move({0, 1})));
+  EXPECT_FALSE(moves.has_move_at({3, 0}));
+
+  // resizing keeps the moves' cells
+  moves.reserve_for(6, 5);
+  EXPECT_TRUE(moves.has_move_at({2, 3}));
+  EXPECT_TRUE(moves.has_move_at({0, 1}));
+  EXPECT_FALSE(moves.has_move_at({1, 1}));
+  EXPECT_FALSE(moves.insert_if_unique(make_move({2, 3})));
+
+  // as does growing past the size to fit a move
+  EXPECT_TRUE(moves.insert_if_unique(make_move({9, 7})));
+  EXPECT_TRUE(moves.has_move_at({2, 3}));
+  EXPECT_FALSE(moves.insert_if_unique(make_move({9, 7})));
+  EXPECT_EQ(3, moves.size());
+}
+
+TEST(TrivialMovesTest, rules_are_ordered_cheapest_first) {
+  auto const rules = trivial_move_rules();
+  ASSERT_FALSE(rules.empty());
+  EXPECT_STREQ("around walls with deps", rules.front().name);
+  EXPECT_TRUE(std::is_sorted(
+      rules.begin(),
+      rules.end(),
+      [](TrivialMoveRule const & lhs, TrivialMoveRule const & rhs) {
+        return lhs.cost < rhs.cost;
+      }));
+}
+
+TEST(TrivialMovesTest, rule_counters_are_per_thread) {
+  model::ASCIILevelCreator creator;
+  creator("01*");
+  creator("..0");
+  model::BasicBoard board;
+  creator.finished(&board);
+  std::unique_ptr board_analysis = create_board_analysis(board);
+  AnnotatedMoves  moves;
+
+  reset_trivial_move_rule_counters();
+  find_trivial_moves(board, board_analysis.get(), moves);
+  TrivialMoveRule const & first_rule = trivial_move_rules().front();
+#ifdef DEBUGPROFILE
+  EXPECT_EQ(1, trivial_move_rule_counters(first_rule).num_calls);
+#else
+  EXPECT_EQ(0, trivial_move_rule_counters(first_rule).num_calls);
+#endif
+
+  // another thread has counted nothing
+  TrivialMoveRuleCounters other_thread;
+  std::thread([&] {
+    other_thread = trivial_move_rule_counters(first_rule);
+  }).join();
+  EXPECT_EQ(0, other_thread.num_calls);
+}
+
+namespace {
+int num_added_rule_calls = 0;
+
+OptCoord
+count_added_rule_call(TrivialMoveInputs const &, AnnotatedMoves &) {
+  ++num_added_rule_calls;
+  return std::nullopt;
+}
+} // namespace
+
+TEST(TrivialMovesTest, added_rule_runs_until_moves_are_found) {
+  add_trivial_move_rule({"counting",
+                         DecisionType::NONE,
+                         3,
+                         false,
+                         count_added_rule_call});
+  num_added_rule_calls = 0;
+
+  // the wall rule is cheaper, and finds a move first
+  model::ASCIILevelCreator with_moves;
+  with_moves("01*");
+  with_moves("..0");
+  model::BasicBoard board;
+  with_moves.finished(&board);
+  std::unique_ptr board_analysis = create_board_analysis(board);
+  AnnotatedMoves  moves;
+  find_trivial_moves(board, board_analysis.get(), moves);
+  EXPECT_FALSE(moves.empty());
+  EXPECT_EQ(0, num_added_rule_calls);
+
+  model::ASCIILevelCreator without_moves;
+  without_moves("...");
+  without_moves(".1.");
+  without_moves("...");
+  without_moves.finished(&board);
+  board_analysis = create_board_analysis(board);
+  moves.clear();
+  find_trivial_moves(PositionBoard(board), board_analysis.get(), moves);
+  EXPECT_EQ(1, num_added_rule_calls);
+
+  EXPECT_TRUE(remove_trivial_move_rule("counting"));
+  EXPECT_FALSE(remove_trivial_move_rule("counting"));
+}
+
+
+namespace {
+// The built-in rules, one after another, from the functions that walk the
+// lines from each cell instead of reading the shared segment counts.
+OptCoord
+find_trivial_moves_by_line_scans(model::BasicBoard const & board,
+                                 BoardAnalysis *           board_analysis,
+                                 AnnotatedMoves &          moves) {
+  find_around_walls_with_deps(board, board_analysis, moves);
+  if (moves.empty()) {
+    find_ambiguous_linear_aligned_row_cells(board, moves);
+  }
+  if (moves.empty()) {
+    find_ambiguous_linear_aligned_col_cells(board, moves);
+  }
+  return find_isolated_cells(board, board_analysis, moves);
+}
+} // namespace
+
+TEST(TrivialMovesTest, rules_match_line_scans_on_random_positions) {
+  CellState const walls[] = {CellState::WALL0,
+                             CellState::WALL1,
+                             CellState::WALL2,
+                             CellState::WALL3,
+                             CellState::WALL4};
+  std::mt19937 rng(2468);
+  int          num_ambiguous = 0;
+  for (int game = 0; game < 400; ++game) {
+    int const     height = 3 + game % 9;
+    int const     width  = 3 + game % 11;
+    PositionBoard position(height, width);
+    for (int i = 0; i < height * width / 5; ++i) {
+      position.add_wall({int(rng() % height), int(rng() % width)},
+                        walls[rng() % std::size(walls)]);
+    }
+    position.track_segment_empties();
+    std::unique_ptr board_analysis =
+        create_board_analysis(position.board());
+
+    AnnotatedMoves expected;
+    AnnotatedMoves from_board;
+    AnnotatedMoves from_position;
+    for (int round = 0; round < 40 && not position.has_error() &&
+                        not position.is_solved();
+         ++round) {
+      model::BasicBoard const & board = position.board();
+      expected.clear();
+      from_board.clear();
+      from_position.clear();
+      OptCoord const expected_result = find_trivial_moves_by_line_scans(
+          board, board_analysis.get(), expected);
+      ASSERT_EQ(expected_result,
+                find_trivial_moves(board, board_analysis.get(), from_board))
+          << board;
+      ASSERT_EQ(expected, from_board) << board;
+      ASSERT_EQ(
+          expected_result,
+          find_trivial_moves(position, board_analysis.get(), from_position))
+          << board;
+      ASSERT_EQ(expected, from_position) << board;
+      num_ambiguous += std::any_of(
+          expected.begin(), expected.end(), [](AnnotatedMove const & move) {
+            return move.reason ==
+                   DecisionType::VIOLATES_SINGLE_UNIQUE_SOLUTION;
+          });
+
+      Coord const coord(rng() % height, rng() % width);
+      if (model::is_empty(position.get_cell(coord))) {
+        CellState const cell = rng() % 3 ? CellState::MARK : CellState::BULB;
+        position.apply_move({Action::ADD, CellState::EMPTY, cell, coord});
+      }
+    }
+  }
+  // the ambiguity checks were exercised, not just the walls
+  EXPECT_GT(num_ambiguous, 0);
+}
+
+TEST(TrivialMovesTest, deferred_light_is_not_empty) {
+  for (bool track_segments : {false, true}) {
+    // ..
+    // .0
+    PositionBoard position(2, 2);
+    position.add_wall({1, 1}, CellState::WALL0);
+    if (track_segments) {
+      position.track_segment_empties();
+    }
+    position.set_illum_policy(
+        PositionBoard::IllumPolicy::DEFER_UNTIL_MATERIALIZED);
+    position.add_bulb({0, 0});
+    ASSERT_TRUE(model::is_empty(position.board().get_cell({0, 1})));
+
+    std::unique_ptr board_analysis =
+        create_board_analysis(position.board());
+    AnnotatedMoves moves;
+    EXPECT_EQ(std::nullopt,
+              find_trivial_moves(position, board_analysis.get(), moves));
+    EXPECT_TRUE(moves.empty()) << "tracking segments: " << track_segments;
+  }
+}
+
+TEST(TrivialMovesTest, deferring_position_finds_the_same_moves) {
+  CellState const walls[] = {CellState::WALL0,
+                             CellState::WALL1,
+                             CellState::WALL2,
+                             CellState::WALL3,
+                             CellState::WALL4};
+  std::mt19937 rng(1357);
+  for (int game = 0; game < 200; ++game) {
+    int const     height = 3 + game % 9;
+    int const     width  = 3 + game % 11;
+    PositionBoard written(height, width);
+    for (int i = 0; i < height * width / 5; ++i) {
+      written.add_wall({int(rng() % height), int(rng() % width)},
+                       walls[rng() % std::size(walls)]);
+    }
+    PositionBoard deferring = written;
+    deferring.set_illum_policy(
+        PositionBoard::IllumPolicy::DEFER_UNTIL_MATERIALIZED);
+    // both ways of counting isolated cells
+    if (game % 2) {
+      deferring.track_segment_empties();
+    }
+    std::unique_ptr board_analysis = create_board_analysis(written.board());
+
+    AnnotatedMoves expected;
+    AnnotatedMoves moves;
+    for (int round = 0; round < 40 && not written.has_error() &&
+                        not written.is_solved();
+         ++round) {
+      expected.clear();
+      moves.clear();
+      OptCoord const expected_result =
+          find_trivial_moves(written, board_analysis.get(), expected);
+      ASSERT_EQ(expected_result,
+                find_trivial_moves(deferring, board_analysis.get(), moves))
+          << written;
+      ASSERT_EQ(expected, moves) << written;
+
+      Coord const coord(rng() % height, rng() % width);
+      if (model::is_empty(written.get_cell(coord))) {
+        CellState const  cell = rng() % 3 ? CellState::MARK : CellState::BULB;
+        SingleMove const move{Action::ADD, CellState::EMPTY, cell, coord};
+        written.apply_move(move);
+        deferring.apply_move(move);
+      }
+    }
+  }
+}
+
 } // namespace solver::test
@@ -1,15 +1,18 @@
 #include "trivial_moves.hpp"
 #include "Action.hpp"
+#include "BoardWidth.hpp"
 #include "CellState.hpp"
 #include "CellVisitorConcepts.hpp"
 #include "Coord.hpp"
 #include "Direction.hpp"
+#include "PositionBoard.hpp"
 #include "SingleMove.hpp"
 #include "Solution.hpp"
 #include "meta.hpp"
 #include "utils/DebugLog.hpp"
 #include <algorithm>
 #include <array>
+#include <chrono>
 #include <memory>
 #include <optional>
 
@@ -21,18 +24,6 @@ using model::Coord;
 using model::Direction;
 
 namespace {
-void
-insert_if_unique(AnnotatedMoves & moves, AnnotatedMove const & move) {
-  if (std::find_if(
-          begin(moves),
-          end(moves),
-          [where = move.next_move.coord_](AnnotatedMove const & existing) {
-            return existing.next_move.coord_ == where;
-          }) == end(moves)) {
-    moves.push_back(move);
-  }
-}
-
 void
 add_cell(AnnotatedMoves & moves,
          CellState        cell,
@@ -40,13 +31,11 @@ add_cell(AnnotatedMoves & moves,
          DecisionType     why,
          MoveMotive       motive,
          OptCoord         ref_location) {
-  insert_if_unique(
-      moves,
-      AnnotatedMove{
-          model::SingleMove{model::Action::ADD, CellState::EMPTY, cell, where},
-          why,
-          motive,
-          ref_location});
+  moves.insert_if_unique(AnnotatedMove{
+      model::SingleMove{model::Action::ADD, CellState::EMPTY, cell, where},
+      why,
+      motive,
+      ref_location});
 }
 
 void
@@ -67,92 +56,387 @@ add_mark(AnnotatedMoves & moves,
   add_cell(moves, CellState::MARK, where, why, motive, ref_location);
 }
 
-int
-get_col_span_empty_count(Coord                              coord,
-                         model::BasicBoard const &          board,
-                         std::vector<CellSpanCount> const & col_span_cache) {
-  auto col_span_iter = std::lower_bound(
-      begin(col_span_cache),
-      end(col_span_cache),
-      coord,
-      [&](CellSpanCount const & cell_span_count, Coord coord) {
-        return cell_span_count.span_start_coord.col_ < coord.col_;
+// The kernels below work on flat cell indices and the planes of the board,
+// and are instantiated for the common board widths (see with_board_width) so
+// their index arithmetic uses constants.
+
+// The kernels take the empty cells as a plane of their own, rather than the
+// board's EMPTY plane, since a position deferring its light keeps lit cells
+// EMPTY in its board (see unlit_empties.)
+
+// num_segment_empties(row_segment, col_segment) is the number of empty cells
+// in the two segments. (An illuminable cell never shares a segment with a
+// bulb, since the bulb would light it.)
+template <typename WidthT, typename EmptiesT>
+OptCoord
+find_isolated_cells(WidthT                    width,
+                    model::BasicBoard const & board,
+                    model::BitPlane const &   empties,
+                    SegmentIndex const &      segments,
+                    EmptiesT &&               num_segment_empties,
+                    AnnotatedMoves &          moves) {
+  auto const illuminable = empties | board.plane(model::CellPlane::MARK);
+
+  // walk the illuminable cells, and find any isolated empty cells, or
+  // marks. The sum of the counts of its row and column segments is the
+  // number of empties in all its directions, plus the cell itself if empty.
+  OptCoord unlightable_mark_coord;
+  illuminable.visit_set_bits([&](int idx) {
+    int const row_col_empty_count = num_segment_empties(
+        segments.row_segment_of[idx], segments.col_segment_of[idx]);
+    if (row_col_empty_count > 2) {
+      return;
+    }
+
+    Coord const coord = model::coord_of(idx, width);
+    if (empties.test(idx)) {
+      if (row_col_empty_count == 2) {
+        add_bulb(moves,
+                 coord,
+                 DecisionType::ISOLATED_EMPTY_SQUARE,
+                 MoveMotive::FORCED);
+      }
+    }
+    else if (row_col_empty_count == 1) {
+      // this is an isolated mark but we don't know where
+      // its empty cell is. Find it.
+      board.visit_rows_cols_outward(coord, [&](auto adj_coord, auto) {
+        if (empties.test(model::flat_idx_of(adj_coord, width))) {
+          add_bulb(moves,
+                   adj_coord,
+                   DecisionType::ISOLATED_MARK,
+                   MoveMotive::FORCED,
+                   coord);
+          return model::STOP_VISITING;
+        }
+        return model::KEEP_VISITING;
       });
+    }
+    else if (row_col_empty_count == 0) {
+      unlightable_mark_coord = coord;
+    }
+  });
+  return unlightable_mark_coord;
+}
 
-  int count = -1;
-  while (col_span_iter != end(col_span_cache) &&
-         col_span_iter->span_start_coord.col_ <= coord.col_ &&
-         col_span_iter->span_start_coord.row_ <= coord.row_) {
-    assert(col_span_iter->span_start_coord.col_ == coord.col_);
-    count = col_span_iter->count;
-    ++col_span_iter;
+// Collects the flat indices of the cells adjacent to idx into adjacent, in
+// the same order as BasicBoard::visit_adjacent. Returns how many there are.
+template <typename WidthT>
+int
+get_adjacent_indices(WidthT               width,
+                     int                  height,
+                     int                  idx,
+                     std::array<int, 4> & adjacent) {
+  int const w     = width.value();
+  int const col   = idx % w;
+  int       count = 0;
+  if (idx >= w) {
+    adjacent[count++] = idx - w;
+  }
+  if (col > 0) {
+    adjacent[count++] = idx - 1;
   }
+  if (idx + w < height * w) {
+    adjacent[count++] = idx + w;
+  }
+  if (col + 1 < w) {
+    adjacent[count++] = idx + 1;
+  }
+  return count;
+}
 
-  if (count != -1) {
-    return count;
+// Counts the empty and the illuminable cells of each row and column segment
+// in one sweep over the illuminable cells, and finds the cells next to a wall
+// with deps. The rules of one search share the counts: the first rule to need
+// them pays for the sweep.
+template <typename WidthT>
+SegmentIndex const &
+count_segments(WidthT                    width,
+               model::BasicBoard const & board,
+               model::BitPlane const &   empties,
+               BoardAnalysis *           board_analysis) {
+  SegmentIndex const & segments = board_analysis->segments(board);
+  if (board_analysis->has_segment_counts) {
+    return segments;
   }
+  board_analysis->has_segment_counts = true;
+
+  auto const   illuminable = empties | board.plane(model::CellPlane::MARK);
+  auto &       row_empties = board_analysis->row_segment_empty_count;
+  auto &       col_empties = board_analysis->col_segment_empty_count;
+  auto & row_illuminables  = board_analysis->row_segment_illuminable_count;
+  auto & col_illuminables  = board_analysis->col_segment_illuminable_count;
+  row_empties.assign(segments.row_segments.size(), 0);
+  col_empties.assign(segments.col_segments.size(), 0);
+  row_illuminables.assign(segments.row_segments.size(), 0);
+  col_illuminables.assign(segments.col_segments.size(), 0);
+  illuminable.visit_set_bits([&](int idx) {
+    int const  row_segment = segments.row_segment_of[idx];
+    int const  col_segment = segments.col_segment_of[idx];
+    bool const empty       = empties.test(idx);
+    ++row_illuminables[row_segment];
+    ++col_illuminables[col_segment];
+    row_empties[row_segment] += empty;
+    col_empties[col_segment] += empty;
+  });
 
-  throw std::runtime_error(fmt::format(
-      "Should not be possible; no column span associated with {}", coord));
-}
-
-std::vector<CellSpanCount> &
-init_row_span_cache(model::BasicBoard const & board,
-                    BoardAnalysis *           board_analysis) {
-  // count all of the row spans... that is, for each contiguous range of
-  // (empty|mark) cells, count the empties, and store them in the sorted
-  // vector keyed by the coordinate of the FIRST cell in the span. Whenever
-  // any other type of cell is seen, it ends that segment.
-  auto & row_span_cache = board_analysis->row_span_cache;
-  row_span_cache.clear();
-  int flat_idx = 0;
-  for (int row = 0; row < board.height(); ++row) {
-    bool in_span = false;
-    for (int col = 0; col < board.width(); ++col, flat_idx++) {
-      CellState cell = board.get_cell_flat_unchecked(flat_idx);
-      if (model::is_translucent(cell)) {
-        if (not in_span) {
-          in_span = true;
-          row_span_cache.push_back(CellSpanCount{Coord{row, col}, 0});
-        }
-        if (model::is_empty(cell)) {
-          row_span_cache.back().count++;
-        }
+  // read from the board, like the line scans, rather than walls_with_deps
+  auto & next_to_walls = board_analysis->next_to_wall_with_deps;
+  next_to_walls.resize(board.width() * board.height());
+  std::array<int, 4> adjacent;
+  board.plane(model::CellPlane::WALL).visit_set_bits([&](int idx) {
+    if (model::is_wall_with_deps(board.get_cell_flat_unchecked(idx))) {
+      int const num_adjacent =
+          get_adjacent_indices(width, board.height(), idx, adjacent);
+      for (int i = 0; i < num_adjacent; ++i) {
+        next_to_walls.set(adjacent[i]);
       }
-      else {
-        in_span = false;
+    }
+  });
+  return segments;
+}
+
+template <typename WidthT>
+OptCoord
+find_isolated_cells(WidthT                    width,
+                    model::BasicBoard const & board,
+                    model::BitPlane const &   empties,
+                    BoardAnalysis *           board_analysis,
+                    AnnotatedMoves &          moves) {
+  if (empties.none() && board.plane(model::CellPlane::MARK).none()) {
+    return std::nullopt;
+  }
+
+  SegmentIndex const & segments =
+      count_segments(width, board, empties, board_analysis);
+  auto const & row_empties = board_analysis->row_segment_empty_count;
+  auto const & col_empties = board_analysis->col_segment_empty_count;
+  return find_isolated_cells(
+      width,
+      board,
+      empties,
+      segments,
+      [&](int row_segment, int col_segment) {
+        return row_empties[row_segment] + col_empties[col_segment];
+      },
+      moves);
+}
+
+// Marks the unconstrained cells of the first segment that has more than one,
+// returning whether there was such a segment. A cell is unconstrained if it is
+// empty, not next to a wall with deps, and the only illuminable cell of its
+// crossing segment. idx_step is the distance between the cells of a segment.
+template <typename WidthT>
+bool
+mark_ambiguous_segment_cells(WidthT                       width,
+                             std::vector<Segment> const & line_segments,
+                             std::vector<int> const &     line_empties,
+                             std::vector<int> const &     cross_segment_of,
+                             std::vector<int> const &     cross_illuminables,
+                             int                          idx_step,
+                             model::BitPlane const &      empties,
+                             model::BitPlane const &      next_to_walls,
+                             AnnotatedMoves &             moves) {
+  auto is_unconstrained = [&](int idx) {
+    return empties.test(idx) && not next_to_walls.test(idx) &&
+           cross_illuminables[cross_segment_of[idx]] == 1;
+  };
+  int const num_segments = static_cast<int>(line_segments.size());
+  for (int segment = 0; segment < num_segments; ++segment) {
+    if (line_empties[segment] < 2) {
+      continue;
+    }
+    int const first = model::flat_idx_of(line_segments[segment].start, width);
+    int const end   = first + line_segments[segment].length * idx_step;
+    int       count = 0;
+    for (int idx = first; idx != end && count < 2; idx += idx_step) {
+      count += is_unconstrained(idx);
+    }
+    if (count < 2) {
+      continue;
+    }
+    for (int idx = first; idx != end; idx += idx_step) {
+      if (is_unconstrained(idx)) {
+        add_mark(moves,
+                 model::coord_of(idx, width),
+                 DecisionType::VIOLATES_SINGLE_UNIQUE_SOLUTION,
+                 MoveMotive::FOLLOWUP);
       }
     }
+    return true;
   }
-  return row_span_cache;
-}
-
-std::vector<CellSpanCount> &
-init_col_span_cache(model::BasicBoard const & board,
-                    BoardAnalysis *           board_analysis) {
-
-  auto & col_span_cache = board_analysis->col_span_cache;
-  col_span_cache.clear();
-  for (int col = 0; col < board.width(); ++col) {
-    bool in_span  = false;
-    int  flat_idx = col;
-    for (int row = 0; row < board.height(); ++row, flat_idx += board.width()) {
-      CellState cell = board.get_cell_flat_unchecked(flat_idx);
-      if (model::is_translucent(cell)) {
-        if (not in_span) {
-          in_span = true;
-          col_span_cache.push_back(CellSpanCount{Coord{row, col}, 0});
-        }
-        if (model::is_empty(cell)) {
-          col_span_cache.back().count++;
+  return false;
+}
+
+// The ambiguous cells of the rows, or of the columns, from the segment counts.
+// Finds the same moves as find_ambiguous_linear_aligned_{row,col}_cells.
+template <typename WidthT>
+void
+find_ambiguous_segment_cells(WidthT                    width,
+                             model::BasicBoard const & board,
+                             model::BitPlane const &   empties,
+                             BoardAnalysis *           board_analysis,
+                             bool                      along_cols,
+                             AnnotatedMoves &          moves) {
+  if (empties.none()) {
+    return;
+  }
+  SegmentIndex const & segments =
+      count_segments(width, board, empties, board_analysis);
+  if (along_cols) {
+    mark_ambiguous_segment_cells(width,
+                                 segments.col_segments,
+                                 board_analysis->col_segment_empty_count,
+                                 segments.row_segment_of,
+                                 board_analysis->row_segment_illuminable_count,
+                                 width.value(),
+                                 empties,
+                                 board_analysis->next_to_wall_with_deps,
+                                 moves);
+  }
+  else {
+    mark_ambiguous_segment_cells(width,
+                                 segments.row_segments,
+                                 board_analysis->row_segment_empty_count,
+                                 segments.col_segment_of,
+                                 board_analysis->col_segment_illuminable_count,
+                                 1,
+                                 empties,
+                                 board_analysis->next_to_wall_with_deps,
+                                 moves);
+  }
+}
+
+// the position already knows how many empty cells each segment has
+template <typename WidthT>
+OptCoord
+find_isolated_cells(WidthT                  width,
+                    PositionBoard const &   position,
+                    model::BitPlane const & empties,
+                    AnnotatedMoves &        moves) {
+  return find_isolated_cells(
+      width,
+      position.board(),
+      empties,
+      position.segment_index(),
+      [&](int row_segment, int col_segment) {
+        return position.num_row_segment_empties(row_segment) +
+               position.num_col_segment_empties(col_segment);
+      },
+      moves);
+}
+
+// tally(wall_coord, idx, empty_count, bulb_count) counts the empty cells and
+// bulbs next to a wall.
+template <typename WidthT, typename TallyT>
+void
+find_around_walls_with_deps(WidthT                    width,
+                            model::BasicBoard const & board,
+                            model::BitPlane const &   empties,
+                            BoardAnalysis *           board_analysis,
+                            AnnotatedMoves &          moves,
+                            TallyT &&                 tally) {
+  std::array<int, 4> adjacent;
+  for (Coord wall_coord : board_analysis->walls_with_deps) {
+    int const idx         = model::flat_idx_of(wall_coord, width);
+    int const deps        = num_wall_deps(board.get_cell_flat_unchecked(idx));
+    int       empty_count = 0;
+    int       bulb_count  = 0;
+    tally(wall_coord, idx, empty_count, bulb_count);
+    if (empty_count == 0 ||
+        (empty_count != deps - bulb_count && bulb_count != deps)) {
+      continue;
+    }
+    int const num_adjacent =
+        get_adjacent_indices(width, board.height(), idx, adjacent);
+
+    // all empty faces around wall must be bulbs
+    if (empty_count == deps - bulb_count) {
+      for (int i = 0; i < num_adjacent; ++i) {
+        if (empties.test(adjacent[i])) {
+          add_bulb(moves,
+                   model::coord_of(adjacent[i], width),
+                   DecisionType::WALL_DEPS_EQUAL_OPEN_FACES,
+                   MoveMotive::FORCED,
+                   wall_coord);
         }
       }
-      else {
-        in_span = false;
+    }
+    // all empty faces around wall must be marks (wall satisfied)
+    if (bulb_count == deps) {
+      for (int i = 0; i < num_adjacent; ++i) {
+        if (empties.test(adjacent[i])) {
+          add_mark(moves,
+                   model::coord_of(adjacent[i], width),
+                   DecisionType::WALL_SATISFIED_HAVING_OPEN_FACES,
+                   MoveMotive::FORCED,
+                   wall_coord);
+        }
       }
     }
   }
-  return col_span_cache;
+}
+
+template <typename WidthT>
+void
+find_around_walls_with_deps(WidthT                    width,
+                            model::BasicBoard const & board,
+                            model::BitPlane const &   empties,
+                            BoardAnalysis *           board_analysis,
+                            AnnotatedMoves &          moves) {
+  auto const & bulbs = board.plane(model::CellPlane::BULB);
+
+  std::array<int, 4> adjacent;
+  find_around_walls_with_deps(
+      width,
+      board,
+      empties,
+      board_analysis,
+      moves,
+      [&](Coord, int idx, int & empty_count, int & bulb_count) {
+        int const num_adjacent =
+            get_adjacent_indices(width, board.height(), idx, adjacent);
+        for (int i = 0; i < num_adjacent; ++i) {
+          empty_count += empties.test(adjacent[i]);
+          bulb_count += bulbs.test(adjacent[i]);
+        }
+      });
+}
+
+// the position already knows what is next to each wall
+template <typename WidthT>
+void
+find_around_walls_with_deps(WidthT                  width,
+                            PositionBoard const &   position,
+                            model::BitPlane const & empties,
+                            BoardAnalysis *         board_analysis,
+                            AnnotatedMoves &        moves) {
+  find_around_walls_with_deps(
+      width,
+      position.board(),
+      empties,
+      board_analysis,
+      moves,
+      [&](Coord wall_coord, int, int & empty_count, int & bulb_count) {
+        empty_count = position.num_adjacent_empties(wall_coord);
+        bulb_count  = position.num_adjacent_bulbs(wall_coord);
+      });
+}
+
+// The empty cells of a position that are not lit. A position deferring its
+// light leaves lit cells EMPTY in its board, so they are taken out, into
+// scratch space; otherwise they are the board's EMPTY plane.
+model::BitPlane const &
+unlit_empties(PositionBoard const & position, BoardAnalysis * board_analysis) {
+  auto const & empties = position.board().plane(model::CellPlane::EMPTY);
+  if (position.illum_policy() == PositionBoard::IllumPolicy::WRITE_WHEN_LIT) {
+    return empties;
+  }
+  auto & unlit = board_analysis->unlit_empties;
+  unlit        = position.lit_cells();
+  unlit &= empties;
+  unlit ^= empties;
+  return unlit;
 }
 
 } // namespace
@@ -168,65 +452,90 @@ OptCoord
 find_isolated_cells(model::BasicBoard const & board,
                     BoardAnalysis *           board_analysis,
                     AnnotatedMoves &          moves) {
+  board_analysis->has_segment_counts = false;
+  return model::with_board_width(board.width(), [&](auto width) {
+    return find_isolated_cells(width,
+                               board,
+                               board.plane(model::CellPlane::EMPTY),
+                               board_analysis,
+                               moves);
+  });
+}
 
-  auto & row_span_cache = init_row_span_cache(board, board_analysis);
-  auto & col_span_cache = init_col_span_cache(board, board_analysis);
+OptCoord
+find_isolated_cells(PositionBoard const & position,
+                    BoardAnalysis *       board_analysis,
+                    AnnotatedMoves &      moves) {
+  model::BitPlane const & empties = unlit_empties(position, board_analysis);
+  board_analysis->has_segment_counts = false;
+  return model::with_board_width(position.width(), [&](auto width) {
+    if (not position.tracks_segment_empties()) {
+      return find_isolated_cells(
+          width, position.board(), empties, board_analysis, moves);
+    }
+    return find_isolated_cells(width, position, empties, moves);
+  });
+}
 
-  // now walk the board, and find any isolated empty cells, or marks, using
-  // the caches we just populated. Just find the row span and column span it
-  // is in, and sum them up to know the number of empties in all its
-  // directions, and account for what the cell is itself.
-  OptCoord unlightable_mark_coord;
-  for (auto & cur_row_span : row_span_cache) {
-    board.visit_row_right_of(
-        cur_row_span.span_start_coord,
-        [&](Coord coord, CellState cell) {
-          if (not is_illuminable(cell)) {
-            return;
-          }
-          const int row_col_empty_count =
-              cur_row_span.count +
-              get_col_span_empty_count(coord, board, col_span_cache);
-
-          if (is_empty(cell) && row_col_empty_count == 2) {
-            add_bulb(moves,
-                     coord,
-                     DecisionType::ISOLATED_EMPTY_SQUARE,
-                     MoveMotive::FORCED);
-          }
-          else if (is_mark(cell)) {
-            if (row_col_empty_count == 1) {
-              // this is an isolated mark but we don't know where
-              // its empty cell is. Find it.
-              board.visit_rows_cols_outward(
-                  coord, [&](auto adj_coord, auto adj_cell) {
-                    if (is_empty(adj_cell)) {
-                      add_bulb(moves,
-                               adj_coord,
-                               DecisionType::ISOLATED_MARK,
-                               MoveMotive::FORCED,
-                               coord);
-                      return model::STOP_VISITING;
-                    }
-                    return model::KEEP_VISITING;
-                  });
-            }
-            else if (row_col_empty_count == 0) {
-              //              std::cout << "Unlightable mark at : " << coord <<
-              //              "\n";
-              unlightable_mark_coord = coord;
-            }
-          }
-        },
-        (model::BasicBoard::VisitPolicy::VISIT_START_COORD |
-         model::BasicBoard::VisitPolicy::SKIP_TERMINATING_WALL));
+namespace {
+
+// The ambiguous-cells scan is the same along rows and along columns, so it is
+// written once for a Line describing which way to walk. Along columns it
+// reads contiguous cells if the board keeps a column-major mirror.
+struct AlongRow {
+  static constexpr Direction direction = Direction::RIGHT;
+
+  static int
+  num_lines(model::BasicBoard const & board) {
+    return board.height();
   }
-  return unlightable_mark_coord;
-}
+  static int
+  line_length(model::BasicBoard const & board) {
+    return board.width();
+  }
+  static Coord
+  coord(int line, int pos) {
+    return {line, pos};
+  }
+  static int
+  pos_of(Coord coord) {
+    return coord.col_;
+  }
+  static void
+  visit_after(model::BasicBoard const & board, Coord coord, auto && visitor) {
+    board.visit_row_right_of(coord, visitor);
+  }
+};
+
+struct AlongCol {
+  static constexpr Direction direction = Direction::DOWN;
+
+  static int
+  num_lines(model::BasicBoard const & board) {
+    return board.width();
+  }
+  static int
+  line_length(model::BasicBoard const & board) {
+    return board.height();
+  }
+  static Coord
+  coord(int line, int pos) {
+    return {pos, line};
+  }
+  static int
+  pos_of(Coord coord) {
+    return coord.row_;
+  }
+  static void
+  visit_after(model::BasicBoard const & board, Coord coord, auto && visitor) {
+    board.visit_col_below(coord, visitor);
+  }
+};
 
+template <typename Line>
 void
-find_ambiguous_linear_aligned_row_cells(model::BasicBoard const & board,
-                                        AnnotatedMoves &          moves) {
+find_ambiguous_linear_aligned_cells(model::BasicBoard const & board,
+                                    AnnotatedMoves &          moves) {
   // for any co-linear cells that have no cross-visible illuminable cells
   // Example: The empty cells below the '0' walls are inter-changeable for
   // where the bulb could go, leading to multiple solutions and ambiguity.
@@ -245,37 +554,41 @@ find_ambiguous_linear_aligned_row_cells(model::BasicBoard const & board,
   // and then there is only one place to play to illuminate the marks:
   // Coord(1,2), which also solves it.
 
-  // This algorithm tests every separate horizontal row section in a
-  // single pass of the board.
-  int row = 0;
-  int col = -1;
-  while (row < board.height()) {
+  // This algorithm tests every separate section of each line in a single
+  // pass of the board.
+  int line = 0;
+  int pos  = -1;
+  while (line < Line::num_lines(board)) {
     int      count = 0;
     OptCoord prev;
-    board.visit_row_right_of(Coord{row, col}, [&](Coord coord, CellState cell) {
-      col = coord.col_;
-      if (is_empty(cell)) {
-        bool constrained = false;
-        board.visit_adjacent(coord, [&](Coord, CellState cell) {
-          constrained |= model::is_wall_with_deps(cell);
-        });
-        board.visit_perpendicular(
-            coord, Direction::RIGHT, [&](Coord, CellState cell) {
-              constrained |= model::is_illuminable(cell);
-              return constrained ? model::STOP_VISITING : model::KEEP_VISITING;
+    Line::visit_after(
+        board, Line::coord(line, pos), [&](Coord coord, CellState cell) {
+          pos = Line::pos_of(coord);
+          if (is_empty(cell)) {
+            bool constrained = false;
+            board.visit_adjacent(coord, [&](Coord, CellState cell) {
+              constrained |= model::is_wall_with_deps(cell);
             });
-        if (not constrained) {
-          if (prev) {
-            add_mark(moves,
-                     *prev,
-                     DecisionType::VIOLATES_SINGLE_UNIQUE_SOLUTION,
-                     MoveMotive::FOLLOWUP);
+            if (not constrained) {
+              board.visit_perpendicular(
+                  coord, Line::direction, [&](Coord, CellState cell) {
+                    constrained |= model::is_illuminable(cell);
+                    return constrained ? model::STOP_VISITING
+                                       : model::KEEP_VISITING;
+                  });
+            }
+            if (not constrained) {
+              if (prev) {
+                add_mark(moves,
+                         *prev,
+                         DecisionType::VIOLATES_SINGLE_UNIQUE_SOLUTION,
+                         MoveMotive::FOLLOWUP);
+              }
+              ++count;
+              prev = coord;
+            }
           }
-          ++count;
-          prev = coord;
-        }
-      }
-    });
+        });
     if (count > 1) {
       add_mark(moves,
                *prev,
@@ -283,75 +596,49 @@ find_ambiguous_linear_aligned_row_cells(model::BasicBoard const & board,
                MoveMotive::FOLLOWUP);
       return;
     }
-    if (col + 1 >= board.width()) {
-      col = -1;
-      ++row;
+    if (pos + 1 >= Line::line_length(board)) {
+      pos = -1;
+      ++line;
     }
   }
 }
 
+} // namespace
+
 void
-find_ambiguous_linear_aligned_col_cells(model::BasicBoard const & board,
+find_ambiguous_linear_aligned_row_cells(model::BasicBoard const & board,
                                         AnnotatedMoves &          moves) {
-  // vertical equivalent of the by-row version.  See its commentary.
+  find_ambiguous_linear_aligned_cells<AlongRow>(board, moves);
+}
 
-  int row = -1;
-  int col = 0;
-  while (col < board.width()) {
-    int      count = 0;
-    OptCoord prev;
-    board.visit_col_below(Coord{row, col}, [&](Coord coord, CellState cell) {
-      row = coord.row_;
-      if (is_empty(cell)) {
-        bool constrained = false;
-        board.visit_adjacent(coord, [&](Coord, CellState cell) {
-          constrained |= model::is_wall_with_deps(cell);
-        });
-        if (not constrained) {
-          board.visit_perpendicular(
-              coord, Direction::DOWN, [&](Coord, CellState cell) {
-                constrained |= model::is_illuminable(cell);
-                return constrained ? model::STOP_VISITING
-                                   : model::KEEP_VISITING;
-              });
-        }
-        if (not constrained) {
-          if (prev) {
-            add_mark(moves,
-                     *prev,
-                     DecisionType::VIOLATES_SINGLE_UNIQUE_SOLUTION,
-                     MoveMotive::FOLLOWUP);
-          }
-          ++count;
-          prev = coord;
-        }
-      }
-    });
-    if (count > 1) {
-      add_mark(moves,
-               *prev,
-               DecisionType::VIOLATES_SINGLE_UNIQUE_SOLUTION,
-               MoveMotive::FOLLOWUP);
-      return;
-    }
-    if (row + 1 >= board.height()) {
-      row = -1;
-      ++col;
-    }
-  }
+void
+find_ambiguous_linear_aligned_col_cells(model::BasicBoard const & board,
+                                        AnnotatedMoves &          moves) {
+  find_ambiguous_linear_aligned_cells<AlongCol>(board, moves);
 }
 
 std::unique_ptr<BoardAnalysis>
 create_board_analysis(model::BasicBoard const & board) {
   std::vector<model::Coord> walls_with_deps;
   walls_with_deps.reserve(16);
-  board.visit_board([&](Coord wall_coord, CellState cell) {
+  auto const & walls = board.plane(model::CellPlane::WALL);
+  board.visit_plane(walls, [&](Coord wall_coord, CellState cell) {
     if (int deps = num_wall_deps(cell); deps > 0) {
       walls_with_deps.push_back(wall_coord);
     }
   });
 
-  return std::make_unique<BoardAnalysis>(walls_with_deps);
+  return std::make_unique<BoardAnalysis>(walls_with_deps, board);
+}
+
+SegmentIndex const &
+BoardAnalysis::segments(model::BasicBoard const & board) {
+  // Walls are fixed while solving, but the level generator adds walls as it
+  // goes while reusing one analysis. That is rare enough to simply rebuild.
+  if (segment_index.walls != board.plane(model::CellPlane::WALL)) {
+    segment_index = SegmentIndex(board);
+  }
+  return segment_index;
 }
 
 // for performance, merges 2 algos into 1:
@@ -362,55 +649,248 @@ void
 find_around_walls_with_deps(model::BasicBoard const & board,
                             BoardAnalysis *           board_analysis,
                             AnnotatedMoves &          moves) {
-  for (Coord wall_coord : board_analysis->walls_with_deps) {
-    CellState cell        = board.get_cell(wall_coord);
-    int       empty_count = 0;
-    int       bulb_count  = 0;
-    int       deps        = num_wall_deps(cell);
-    board.visit_adjacent(wall_coord, [&](Coord coord, auto cell) {
-      empty_count += cell == EMPTY;
-      bulb_count += cell == BULB;
+  model::with_board_width(board.width(), [&](auto width) {
+    find_around_walls_with_deps(width,
+                                board,
+                                board.plane(model::CellPlane::EMPTY),
+                                board_analysis,
+                                moves);
+  });
+}
+
+void
+find_around_walls_with_deps(PositionBoard const & position,
+                            BoardAnalysis *       board_analysis,
+                            AnnotatedMoves &      moves) {
+  model::BitPlane const & empties = unlit_empties(position, board_analysis);
+  model::with_board_width(position.width(), [&](auto width) {
+    find_around_walls_with_deps(
+        width, position, empties, board_analysis, moves);
+  });
+}
+
+namespace {
+
+OptCoord
+find_around_walls_rule(TrivialMoveInputs const & inputs,
+                       AnnotatedMoves &          moves) {
+  model::with_board_width(inputs.board.width(), [&](auto width) {
+    if (inputs.position) {
+      find_around_walls_with_deps(width,
+                                  *inputs.position,
+                                  inputs.empties,
+                                  inputs.board_analysis,
+                                  moves);
+    }
+    else {
+      find_around_walls_with_deps(
+          width, inputs.board, inputs.empties, inputs.board_analysis, moves);
+    }
+  });
+  return std::nullopt;
+}
+
+OptCoord
+find_ambiguous_row_cells_rule(TrivialMoveInputs const & inputs,
+                              AnnotatedMoves &          moves) {
+  model::with_board_width(inputs.board.width(), [&](auto width) {
+    find_ambiguous_segment_cells(width,
+                                 inputs.board,
+                                 inputs.empties,
+                                 inputs.board_analysis,
+                                 false,
+                                 moves);
+  });
+  return std::nullopt;
+}
+
+OptCoord
+find_ambiguous_col_cells_rule(TrivialMoveInputs const & inputs,
+                              AnnotatedMoves &          moves) {
+  model::with_board_width(inputs.board.width(), [&](auto width) {
+    find_ambiguous_segment_cells(width,
+                                 inputs.board,
+                                 inputs.empties,
+                                 inputs.board_analysis,
+                                 true,
+                                 moves);
+  });
+  return std::nullopt;
+}
+
+OptCoord
+find_isolated_cells_rule(TrivialMoveInputs const & inputs,
+                         AnnotatedMoves &          moves) {
+  if (inputs.position && inputs.position->tracks_segment_empties()) {
+    return model::with_board_width(inputs.board.width(), [&](auto width) {
+      return find_isolated_cells(
+          width, *inputs.position, inputs.empties, moves);
     });
+  }
+  return model::with_board_width(inputs.board.width(), [&](auto width) {
+    return find_isolated_cells(
+        width, inputs.board, inputs.empties, inputs.board_analysis, moves);
+  });
+}
 
-    // all empty faces around wall must be bulbs
-    if (empty_count > 0 && (empty_count == deps - bulb_count)) {
-      board.visit_adjacent(wall_coord, [&](Coord adj_coord, auto cell) {
-        if (is_empty(cell)) {
-          add_bulb(moves,
-                   adj_coord,
-                   DecisionType::WALL_DEPS_EQUAL_OPEN_FACES,
-                   MoveMotive::FORCED,
-                   wall_coord);
-        }
-      });
+int
+new_rule_id() {
+  static int next_id = 0;
+  return next_id++;
+}
+
+// The walls only need their neighbors. The isolated and the ambiguous cells
+// read the segment counts, which the first of them to run takes in one sweep
+// (the isolated cells of a position use the counts it tracks instead). The
+// isolated cells are always checked, as they find contradictions.
+std::vector<TrivialMoveRule> &
+registered_rules() {
+  static std::vector<TrivialMoveRule> rules = [] {
+    std::vector<TrivialMoveRule> rules{
+        {"around walls with deps",
+         DecisionType::WALL_DEPS_EQUAL_OPEN_FACES,
+         1,
+         false,
+         find_around_walls_rule},
+        {"isolated cells",
+         DecisionType::ISOLATED_EMPTY_SQUARE,
+         2,
+         true,
+         find_isolated_cells_rule},
+        {"ambiguous row cells",
+         DecisionType::VIOLATES_SINGLE_UNIQUE_SOLUTION,
+         4,
+         false,
+         find_ambiguous_row_cells_rule},
+        {"ambiguous col cells",
+         DecisionType::VIOLATES_SINGLE_UNIQUE_SOLUTION,
+         4,
+         false,
+         find_ambiguous_col_cells_rule},
+    };
+    for (TrivialMoveRule & rule : rules) {
+      rule.id = new_rule_id();
     }
-    // all empty faces around wall must be marks (wall satisfied)
-    if (empty_count > 0 && bulb_count == deps) {
-      board.visit_adjacent(wall_coord, [&](Coord adj_coord, auto cell) {
-        if (is_empty(cell)) {
-          add_mark(moves,
-                   adj_coord,
-                   DecisionType::WALL_SATISFIED_HAVING_OPEN_FACES,
-                   MoveMotive::FORCED,
-                   wall_coord);
-        }
-      });
+    return rules;
+  }();
+  return rules;
+}
+
+// by rule id
+std::vector<TrivialMoveRuleCounters> &
+thread_counters() {
+  thread_local std::vector<TrivialMoveRuleCounters> counters;
+  return counters;
+}
+
+OptCoord
+run_rule(TrivialMoveRule const &   rule,
+         TrivialMoveInputs const & inputs,
+         AnnotatedMoves &          moves) {
+#ifdef DEBUGPROFILE
+  auto & all_counters = thread_counters();
+  if (rule.id >= static_cast<int>(all_counters.size())) {
+    all_counters.resize(rule.id + 1);
+  }
+  TrivialMoveRuleCounters & counters  = all_counters[rule.id];
+  auto const                start     = std::chrono::steady_clock::now();
+  std::size_t const         num_moves = moves.size();
+  OptCoord const            result    = rule.find(inputs, moves);
+  counters.time += std::chrono::steady_clock::now() - start;
+  ++counters.num_calls;
+  counters.num_hits += result || moves.size() > num_moves;
+  return result;
+#else
+  return rule.find(inputs, moves);
+#endif
+}
+
+// The rules that always run go after the search for moves, so the moves of
+// the others come first.
+OptCoord
+run_rules(TrivialMoveInputs const & inputs, AnnotatedMoves & moves) {
+  inputs.board_analysis->has_segment_counts = false;
+  auto & rules = registered_rules();
+  for (TrivialMoveRule const & rule : rules) {
+    if (not rule.always_runs) {
+      if (OptCoord contradiction = run_rule(rule, inputs, moves)) {
+        return contradiction;
+      }
+      if (not moves.empty()) {
+        break;
+      }
     }
   }
+  for (TrivialMoveRule const & rule : rules) {
+    if (rule.always_runs) {
+      if (OptCoord contradiction = run_rule(rule, inputs, moves)) {
+        return contradiction;
+      }
+    }
+  }
+  return std::nullopt;
+}
+
+} // namespace
+
+std::span<TrivialMoveRule const>
+trivial_move_rules() {
+  return registered_rules();
+}
+
+void
+add_trivial_move_rule(TrivialMoveRule const & rule) {
+  auto &     rules = registered_rules();
+  auto const where = std::upper_bound(
+      rules.begin(),
+      rules.end(),
+      rule,
+      [](TrivialMoveRule const & lhs, TrivialMoveRule const & rhs) {
+        return lhs.cost < rhs.cost;
+      });
+  rules.insert(where, rule)->id = new_rule_id();
+}
+
+bool
+remove_trivial_move_rule(std::string_view name) {
+  auto const num_removed = std::erase_if(
+      registered_rules(),
+      [name](TrivialMoveRule const & rule) { return rule.name == name; });
+  return num_removed > 0;
+}
+
+TrivialMoveRuleCounters
+trivial_move_rule_counters(TrivialMoveRule const & rule) {
+  auto const & counters = thread_counters();
+  if (rule.id < 0 || rule.id >= static_cast<int>(counters.size())) {
+    return {};
+  }
+  return counters[rule.id];
+}
+
+void
+reset_trivial_move_rule_counters() {
+  thread_counters().clear();
 }
 
 OptCoord
 find_trivial_moves(model::BasicBoard const & board,
                    BoardAnalysis *           board_analysis,
                    AnnotatedMoves &          moves) {
-  find_around_walls_with_deps(board, board_analysis, moves);
-  if (moves.empty()) {
-    find_ambiguous_linear_aligned_row_cells(board, moves);
-  }
-  if (moves.empty()) {
-    find_ambiguous_linear_aligned_col_cells(board, moves);
-  }
-  return find_isolated_cells(board, board_analysis, moves);
+  return run_rules(
+      {board, board.plane(model::CellPlane::EMPTY), nullptr, board_analysis},
+      moves);
+}
+
+OptCoord
+find_trivial_moves(PositionBoard const & position,
+                   BoardAnalysis *       board_analysis,
+                   AnnotatedMoves &      moves) {
+  return run_rules({position.board(),
+                    unlit_empties(position, board_analysis),
+                    &position,
+                    board_analysis},
+                   moves);
 }
 
 } // namespace solver
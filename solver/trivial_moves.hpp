@@ -1,29 +1,54 @@
 #pragma once
 #include "AnnotatedMove.hpp"
+#include "AnnotatedMoves.hpp"
 #include "BasicBoard.hpp"
+#include "BitPlane.hpp"
 #include "Coord.hpp"
+#include "PositionBoard.hpp"
+#include "SegmentIndex.hpp"
 #include "SingleMove.hpp"
+#include <chrono>
 #include <optional>
+#include <span>
+#include <string_view>
 #include <vector>
 
 namespace solver {
 
 using OptCoord         = model::OptCoord;
 using OptAnnotatedMove = std::optional<AnnotatedMove>;
-using AnnotatedMoves   = std::vector<AnnotatedMove>;
-
-struct CellSpanCount {
-  model::Coord span_start_coord{};
-  int          count = 0;
-};
 
 struct BoardAnalysis {
-  BoardAnalysis(std::vector<model::Coord> const & walls_with_deps)
-      : walls_with_deps{walls_with_deps}, row_span_cache{}, col_span_cache{} {}
+  BoardAnalysis(std::vector<model::Coord> const & walls_with_deps,
+                model::BasicBoard const &         board)
+      : walls_with_deps{walls_with_deps}, segment_index{board} {
+    row_segment_empty_count.reserve(segment_index.row_segments.size());
+    col_segment_empty_count.reserve(segment_index.col_segments.size());
+    row_segment_illuminable_count.reserve(segment_index.row_segments.size());
+    col_segment_illuminable_count.reserve(segment_index.col_segments.size());
+    next_to_wall_with_deps.resize(board.width() * board.height());
+  }
+
+  // the segment index for the walls of board, rebuilt first if board has a
+  // different wall layout than the one it was built for.
+  SegmentIndex const & segments(model::BasicBoard const & board);
 
   const std::vector<model::Coord> walls_with_deps;
-  std::vector<CellSpanCount>      row_span_cache;
-  std::vector<CellSpanCount>      col_span_cache;
+  SegmentIndex                    segment_index;
+
+  // scratch space shared by the rules of one search: the number of empty and
+  // of illuminable cells in each segment, and the cells next to a wall with
+  // deps. Valid while has_segment_counts is set, which each search clears.
+  bool             has_segment_counts = false;
+  std::vector<int> row_segment_empty_count;
+  std::vector<int> col_segment_empty_count;
+  std::vector<int> row_segment_illuminable_count;
+  std::vector<int> col_segment_illuminable_count;
+  model::BitPlane  next_to_wall_with_deps;
+
+  // scratch space: the empty cells of a position that defers its light, less
+  // those it has lit
+  model::BitPlane unlit_empties;
 };
 
 std::unique_ptr<BoardAnalysis>
@@ -37,12 +62,24 @@ OptCoord find_isolated_cells(model::BasicBoard const & board,
                              BoardAnalysis *           context,
                              AnnotatedMoves &          moves);
 
+// the same, reading the number of empty cells in each segment from the
+// position, if it tracks them.
+OptCoord find_isolated_cells(PositionBoard const & position,
+                             BoardAnalysis *       context,
+                             AnnotatedMoves &      moves);
+
 // returns moves to add bulbs around walls where all open faces must contain
 // bulbs, and corner marks where a bulb would leave wall unsatisfiable.
 void find_around_walls_with_deps(model::BasicBoard const & board,
                                  BoardAnalysis *           context,
                                  AnnotatedMoves &          moves);
 
+// the same, reading the wall's neighbor tallies from the position rather than
+// counting its neighbors.
+void find_around_walls_with_deps(PositionBoard const & position,
+                                 BoardAnalysis *       context,
+                                 AnnotatedMoves &      moves);
+
 // If multiple cells in a line can only see that line with no walls-with-deps
 // nearby, then they would cause multiple solutions, so all of them need marks.
 void find_ambiguous_linear_aligned_row_cells(model::BasicBoard const & board,
@@ -51,12 +88,69 @@ void find_ambiguous_linear_aligned_row_cells(model::BasicBoard const & board,
 void find_ambiguous_linear_aligned_col_cells(model::BasicBoard const & board,
                                              AnnotatedMoves &          moves);
 
+// What a trivial move rule looks at. position is null when finding moves for
+// a plain board, and otherwise board is the position's board. empties are the
+// cells to treat as empty: a position deferring its light leaves lit cells
+// EMPTY in its board, so rules read these rather than the board's EMPTY plane.
+struct TrivialMoveInputs {
+  model::BasicBoard const & board;
+  model::BitPlane const &   empties;
+  PositionBoard const *     position;
+  BoardAnalysis *           board_analysis;
+};
+
+// A deduction rule run by find_trivial_moves. Rules run cheapest first, and
+// once the moves aren't empty the rest are skipped, except those that always
+// run because they can find a contradiction. find returns the location of a
+// contradiction, if it finds one, which ends the search.
+struct TrivialMoveRule {
+  using FindFn = OptCoord (*)(TrivialMoveInputs const &, AnnotatedMoves &);
+
+  char const * name;
+  DecisionType decision_type; // the reason for its moves, or the main one
+  int          cost;          // relative estimate of a call, to order by
+  bool         always_runs;
+  FindFn       find;
+  int          id = -1; // set when registered, to find its counters
+};
+
+// Only counted in DEBUGPROFILE builds: a rule's calls, the calls that found
+// moves or a contradiction, and the time spent in them. Each thread counts
+// its own calls, so solving on several threads needs no locking.
+struct TrivialMoveRuleCounters {
+  long                     num_calls = 0;
+  long                     num_hits  = 0;
+  std::chrono::nanoseconds time{0};
+};
+
+// the registered rules, cheapest first
+std::span<TrivialMoveRule const> trivial_move_rules();
+
+// Registers a rule, after any rule that costs no more. Rules are shared by all
+// threads, and not locked, so they should be added or removed before solving.
+void add_trivial_move_rule(TrivialMoveRule const & rule);
+bool remove_trivial_move_rule(std::string_view name);
+
+// the calling thread's counters
+TrivialMoveRuleCounters trivial_move_rule_counters(TrivialMoveRule const &);
+void                    reset_trivial_move_rule_counters();
+
 // one-stop shopping for isolated cells, satisfied walls, and walls that can
-// be satisfied with the same number of bulbs as open faces. While it does not
-// expressly validate the board, it may detect a contradiction and return
-// the location of a mark that cannot be illuminated.
+// be satisfied with the same number of bulbs as open faces, running the
+// registered rules. While it does not expressly validate the board, it may
+// detect a contradiction and return the location of a mark that cannot be
+// illuminated.
 OptCoord find_trivial_moves(model::BasicBoard const & board,
                             BoardAnalysis *           context,
                             AnnotatedMoves &          moves);
 
+// The same, using what the position tracks. Each call looks at the whole
+// position rather than only what changed since the last: the walls are read
+// from their neighbor tallies and the cells from their segment counts, which
+// is cheaper than keeping a changed region up to date through every move and
+// rollback of a speculation.
+OptCoord find_trivial_moves(PositionBoard const & position,
+                            BoardAnalysis *       context,
+                            AnnotatedMoves &      moves);
+
 } // namespace solver